@@ -12,6 +12,7 @@
 
 #include "utils/algorithm.hpp"
 #include "utils/files.hpp"
+#include "utils/memo_table.hpp"
 #include "utils/misc.hpp"
 
 #include <array>
@@ -37,10 +38,26 @@ public:
 using constant_pool_type = std::vector<int>;
 using binary_code_buffer_type = std::vector<char>;
 
+// Instruction counted by the profiler together with the source position it was generated for, see
+// virtual_machine::execute_profiled.
+struct profile_point {
+  enum kind_type : unsigned {
+    E_BRANCH, // Conditional jump, counts executions and taken jumps
+    E_ENTRY,  // First instruction of a function, counts executions
+  };
+
+  unsigned address;
+  kind_type kind;
+  int line, column;
+};
+
+using profile_points_type = std::vector<profile_point>;
+
 class chunk {
 private:
   binary_code_buffer_type m_binary_code;
   constant_pool_type m_constant_pool;
+  profile_points_type m_profile_points;
 
 public:
   using value_type = binary_code_buffer_type::value_type;
@@ -62,6 +79,7 @@ public:
 
   void push_back(value_type code) { m_binary_code.push_back(code); }
   void set_constant_pool(constant_pool_type constants) { m_constant_pool = std::move(constants); }
+  void set_profile_points(profile_points_type points) { m_profile_points = std::move(points); }
 
   auto binary_begin() const { return m_binary_code.cbegin(); }
   auto binary_end() const { return m_binary_code.cend(); }
@@ -73,6 +91,8 @@ public:
   auto constants_size() const { return m_constant_pool.size(); }
 
   auto constant_at(std::size_t id) const { return m_constant_pool.at(id); }
+
+  const auto &profile_points() const { return m_profile_points; }
 };
 
 std::optional<chunk> read_chunk(std::istream &);
@@ -150,7 +170,8 @@ public:
   template <auto... I>
   static attribute_tuple_type
   decode_attributes(std::forward_iterator auto &first, [[maybe_unused]] std::forward_iterator auto last, std::index_sequence<I...>) {
-    return std::make_tuple(decode_attribute<I>(first, last)...);
+    // Braced initialization guarantees left-to-right evaluation, unlike function arguments.
+    return attribute_tuple_type{decode_attribute<I>(first, last)...};
   }
 
   decoded_instruction decode(std::forward_iterator auto &first, std::forward_iterator auto last) const {
@@ -176,6 +197,10 @@ private:
   execution_stack_type::size_type m_sp = 0;
   execution_value_type m_r0 = 0;
 
+  // Results of memoized functions and the arguments of the calls that are still being computed.
+  utils::memo_table<execution_value_type> m_memo;
+  std::vector<std::pair<unsigned, execution_stack_type>> m_memo_pending;
+
   bool m_halted = false;
 
 public:
@@ -215,6 +240,19 @@ public:
   }
 
   void push(execution_value_type val) { m_execution_stack.push_back(val); }
+
+  auto &memo() & { return m_memo; }
+  const auto &memo() const & { return m_memo; }
+
+  void begin_memo(unsigned id, execution_stack_type args) { m_memo_pending.emplace_back(id, std::move(args)); }
+
+  void end_memo(execution_value_type result) {
+    if (m_memo_pending.empty()) throw vm_error{"No memoized call to finish"};
+    auto &[id, args] = m_memo_pending.back();
+    m_memo.store(id, std::move(args), result);
+    m_memo_pending.pop_back();
+  }
+
   void halt() { m_halted = true; }
   bool is_halted() const { return m_halted; }
   auto constant(unsigned id) const { return m_program_code.constant_at(id); }
@@ -234,29 +272,42 @@ template <typename... t_instructions> struct instruction_set_description {
 };
 
 template <typename t_desc> class virtual_machine {
+public:
+  // Executions of the profile points of the program, in the same order.
+  struct point_counts {
+    std::uint64_t executed = 0, taken = 0;
+  };
+
+private:
   t_desc instruction_set;
   context<t_desc> m_execution_context;
+  std::vector<point_counts> m_profile_counts;
 
 public:
   constexpr virtual_machine(t_desc desc) : instruction_set{desc}, m_execution_context{} {}
 
   void set_program_code(chunk ch) { m_execution_context = std::move(ch); }
   bool is_halted() const { return m_execution_context.is_halted(); }
+  const auto &memo() const { return m_execution_context.memo(); }
+  const auto &profile_counts() const { return m_profile_counts; }
 
-  void execute_instruction() {
+  // Returns the address following the instruction, where execution continues unless it jumped.
+  unsigned execute_instruction() {
     auto &ctx = m_execution_context;
 
     if (ctx.is_halted()) throw vm_error{"Can't execute, VM is halted"};
     auto current_instruction = instruction_set.instruction_lookup_table[*(m_execution_context.m_ip++)];
 
     // clang-format off
-    std::visit(::utils::visitors{
-      [this](std::monostate) {
+    return std::visit(::utils::visitors{
+      [this](std::monostate) -> unsigned {
         m_execution_context.halt();
         throw vm_error{"Unknown opcode"};},
-      [&ctx](const auto *instr) {
+      [&ctx](const auto *instr) -> unsigned {
         auto attr = instr->decode(ctx.m_ip, ctx.m_ip_end).attributes;
-        instr->action(ctx, attr); }}, current_instruction);
+        auto next = ctx.ip();
+        instr->action(ctx, attr);
+        return next; }}, current_instruction);
     // clang-format on
   }
 
@@ -268,6 +319,30 @@ public:
     auto &ctx = m_execution_context;
     return (ctx.m_execution_stack.size() == 0);
   }
+
+  // Same as execute, but also counts the executions of the profile points. Kept apart so that the
+  // plain loop doesn't pay for the lookup of every address.
+  bool execute_profiled() {
+    auto &ctx = m_execution_context;
+    const auto &points = ctx.m_program_code.profile_points();
+    m_profile_counts.assign(points.size(), {});
+
+    std::vector<point_counts *> counters(ctx.m_program_code.binary_size(), nullptr);
+    for (unsigned i = 0; i < points.size(); ++i) {
+      counters.at(points[i].address) = &m_profile_counts[i];
+    }
+
+    while (!ctx.is_halted()) {
+      auto ip = ctx.ip();
+      auto next = execute_instruction();
+      if (auto *counter = counters[ip]) {
+        ++counter->executed;
+        if (!ctx.is_halted() && ctx.ip() != next) ++counter->taken;
+      }
+    }
+
+    return (ctx.m_execution_stack.size() == 0);
+  }
 };
 
 inline auto read_raw_data(std::istream &is) {
@@ -34,7 +34,9 @@ enum opcode : unsigned char {
   E_PUSH_SP_NULLARY, E_UPDATE_SP_UNARY, 
   
   E_LOAD_R0_NULLARY, E_STORE_R0_NULLARY, 
-  E_PUSH_LOCAL_UNARY, E_MOV_LOCAL_UNARY
+  E_PUSH_LOCAL_UNARY, E_MOV_LOCAL_UNARY,
+
+  E_TAIL_CALL_UNARY, E_MEMO_LOOKUP_BINARY, E_MEMO_STORE_NULLARY
 };
 // clang-format on
 
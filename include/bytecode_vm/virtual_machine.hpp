@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include <fmt/core.h>
 
@@ -104,6 +105,17 @@ constexpr instruction_desc<E_UPDATE_SP_UNARY, unsigned> update_sp_desc = "update
 constexpr instruction_desc<E_PUSH_SP_NULLARY> push_sp_desc = "push_sp";
 constexpr instruction_desc<E_SETUP_CALL_NULLARY> setup_call_desc = "call_setup";
 
+// tail_call: Pops the jump target, replaces the current frame's arguments with the `attr<0>` topmost values
+// and drops everything above them. Return address and saved stack pointer of the current frame are reused
+constexpr instruction_desc<E_TAIL_CALL_UNARY, unsigned> tail_call_desc = "tail_call";
+
+// memo_lookup: Looks up the result of memoized function `attr<0>` for the `attr<1>` arguments of the current frame.
+// On a hit sets r0 to the result and pushes 1, otherwise remembers the arguments for memo_store and pushes 0
+constexpr instruction_desc<E_MEMO_LOOKUP_BINARY, unsigned, unsigned> memo_lookup_desc = "memo_lookup";
+
+// memo_store: Stores r0 as the result of the call started by the last missed memo_lookup
+constexpr instruction_desc<E_MEMO_STORE_NULLARY> memo_store_desc = "memo_store";
+
 constexpr auto push_const_instr = push_const_desc >>
     [](auto &&ctx, auto &&attr) { ctx.push(ctx.constant(std::get<0>(attr))); };
 
@@ -256,6 +268,42 @@ constexpr auto setup_call_instr = setup_call_desc >> [](auto &&ctx, auto &&) {
   ctx.push(cur_sp);
 };
 
+constexpr auto tail_call_instr = tail_call_desc >> [](auto &&ctx, auto &&attr) {
+  auto target = ctx.pop();
+  auto n_args = std::get<0>(attr);
+  auto base = ctx.sp();
+  auto first = ctx.stack_size() - n_args;
+
+  for (unsigned i = 0; i < n_args; ++i) {
+    ctx.at_stack(base + i) = ctx.at_stack(first + i);
+  }
+
+  while (ctx.stack_size() > base + n_args) {
+    ctx.pop();
+  }
+
+  ctx.set_ip(target);
+};
+
+constexpr auto memo_lookup_instr = memo_lookup_desc >> [](auto &&ctx, auto &&attr) {
+  auto [id, n_args] = attr;
+  std::vector<decl_vm::execution_value_type> args;
+  for (unsigned i = 0; i < n_args; ++i) {
+    args.push_back(ctx.at_stack(ctx.sp() + i));
+  }
+
+  if (auto found = ctx.memo().lookup(id, args); found) {
+    ctx.set_r0(*found);
+    ctx.push(1);
+    return;
+  }
+
+  ctx.begin_memo(id, std::move(args));
+  ctx.push(0);
+};
+
+constexpr auto memo_store_instr = memo_store_desc >> [](auto &&ctx, auto &&) { ctx.end_memo(ctx.r0()); };
+
 constexpr auto push_sp_instr = push_sp_desc >> [](auto &&ctx, auto &&) {
   auto cur_sp = ctx.sp();
   ctx.push(cur_sp);
@@ -288,7 +336,7 @@ constexpr auto paracl_isa = decl_vm::instruction_set_description(
     or_instr, cmp_eq_instr, cmp_ne_instr, cmp_gt_instr, cmp_ls_instr, cmp_ge_instr, cmp_le_instr, print_instr,
     push_read, mov_local_rel_instr, push_local_rel_instr, jmp_instr, jmp_true_instr, jmp_false_instr, not_instr,
     setup_call_instr, jmp_dynamic_instr, jmp_dynamic_rel_instr, push_sp_instr, update_sp_instr, load_r0_instr,
-    store_r0_instr, push_local_instr, mov_local_instr
+    store_r0_instr, push_local_instr, mov_local_instr, tail_call_instr, memo_lookup_instr, memo_store_instr
 );
 
 using paracl_isa_type = decltype(paracl_isa);
@@ -18,6 +18,7 @@
 #include "bytecode_vm/virtual_machine.hpp"
 
 #include "frontend/analysis/function_table.hpp"
+#include "frontend/analysis/purity_analyzer.hpp"
 #include "frontend/ast/ast_container.hpp"
 #include "frontend/ast/ast_nodes.hpp"
 #include "frontend/ast/ast_nodes/i_ast_node.hpp"
@@ -36,7 +37,9 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace paracl::codegen {
 
@@ -70,6 +73,12 @@ public:
     assert(res.second && "Reinserting var with the same label");
   }
 
+  // Bind a name to an already allocated frame slot. Does not change the stack depth.
+  void bind_var(std::string_view name, unsigned slot) {
+    [[maybe_unused]] auto res = m_map.emplace(name, slot);
+    assert(res.second && "Reinserting var with the same label");
+  }
+
   void pop_dummy() {
     assert(m_top > 0 && "Ending nonexistent scope");
     --m_top;
@@ -93,11 +102,11 @@ public:
     m_blocks.push_back(block);
   }
 
-  void begin_scope(const frontend::symtab &stab) {
+  void begin_scope(const frontend::symtab &stab, unsigned base) {
     begin_scope();
 
-    for (const auto &v : stab) {
-      push_var(v.first);
+    for (const auto &[name, attr] : stab) {
+      m_blocks.back().bind_var(name, base + attr.m_loc);
     }
   }
 
@@ -143,7 +152,110 @@ public:
 
   void clear() { m_blocks.clear(); }
 
-  codegen_stack_block front() { return m_blocks.front(); }
+  codegen_stack_block back() { return m_blocks.back(); }
+};
+
+// Local variables are allocated once per function frame instead of being pushed and popped every
+// time a scope is entered. Scopes get slots in a stack-like fashion: a nested scope starts right
+// after its parent, while sibling scopes (which can never be live at the same time) share the same
+// slots. For lexically nested lifetimes this is an optimal interval colouring, so the frame size is
+// the deepest chain of nested scopes.
+class frame_layout {
+  std::unordered_map<const frontend::symtab *, unsigned> m_bases;
+  unsigned m_size = 0;
+
+public:
+  void allocate(const frontend::symtab &stab, unsigned base) {
+    m_bases.insert_or_assign(&stab, base);
+    m_size = std::max<unsigned>(m_size, base + stab.size());
+  }
+
+  unsigned base(const frontend::symtab &stab) const {
+    auto found = m_bases.find(&stab);
+    assert(found != m_bases.end() && "Scope is missing from the frame layout");
+    return found->second;
+  }
+
+  unsigned size() const { return m_size; }
+};
+
+class frame_layout_builder final
+    : public ezvis::visitor_base<const ast::i_ast_node, frame_layout_builder, void> {
+  frame_layout m_layout;
+  unsigned m_top = 0;
+
+private:
+  void allocate_scope(const frontend::symtab &stab, auto &&nested) {
+    const auto base = m_top;
+    m_layout.allocate(stab, base);
+    m_top += stab.size();
+    nested();
+    m_top = base;
+  }
+
+  void allocate_statements(const auto &block) {
+    allocate_scope(block.stab, [this, &block] {
+      for (const auto *st : block) {
+        assert(st && "Broken statement pointer");
+        // Nested function definitions get frames of their own.
+        if (ast::identify_node(*st) == ast::ast_node_type::E_FUNCTION_DEFINITION) continue;
+        apply(*st);
+      }
+    });
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void allocate(const ast::statement_block &ref) { allocate_statements(ref); }
+  void allocate(const ast::value_block &ref) { allocate_statements(ref); }
+
+  void allocate(const ast::if_statement &ref) {
+    allocate_scope(ref.control_block_symtab, [this, &ref] {
+      apply(*ref.cond());
+      apply(*ref.true_block());
+      if (ref.else_block()) apply(*ref.else_block());
+    });
+  }
+
+  void allocate(const ast::while_statement &ref) {
+    allocate_scope(ref.symbol_table, [this, &ref] {
+      apply(*ref.cond());
+      apply(*ref.block());
+    });
+  }
+
+  void allocate(const ast::assignment_statement &ref) { apply(ref.right()); }
+  void allocate(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void allocate(const ast::unary_expression &ref) { apply(ref.expr()); }
+  void allocate(const ast::print_statement &ref) { apply(ref.expr()); }
+  void allocate(const ast::subscript &ref) { apply(*ref.get_subscript()); }
+
+  void allocate(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void allocate(const ast::function_call &ref) {
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void allocate(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(allocate);
+
+  frame_layout build(const ast::i_ast_node &body) {
+    m_layout = {};
+    m_top = 0;
+    apply(body);
+    return m_layout;
+  }
 };
 
 // It's really necessary to put all of this code inside an anonymous namespace to avoid external
@@ -158,7 +270,12 @@ class codegen_visitor final
 private:
   std::unordered_map<int, unsigned> m_constant_map;
 
-  const frontend::ast::function_definition *m_curr_function;
+  const frontend::ast::function_definition *m_curr_function = nullptr;
+  unsigned m_body_start = 0; // First instruction of the current function's body, after the frame
+
+  bool m_memoize = false;       // Cache the results of pure functions, see purity_analyzer
+  bool m_curr_memoized = false; // The function being generated is memoized
+  unsigned m_memoized_count = 0;
   struct reloc_constant {
     unsigned m_index;
     unsigned m_address;
@@ -180,7 +297,19 @@ private:
   };
 
   std::vector<reloc_info> m_relocations_function_calls;
-  std::vector<unsigned> m_exit_relocations;
+
+  // Instructions counted by `pclvm --write-profile`, see utils::execution_profile.
+  bytecode_vm::decl_vm::profile_points_type m_profile_points;
+
+  // The value block left by return statements.
+  struct return_target {
+    const frontend::ast::value_block *m_block;
+    unsigned m_stack_size;              // Stack size at the start of the block
+    std::vector<unsigned> m_exit_jumps; // Jumps to the end of the block, relocated after it
+    bool m_function_body;
+  };
+
+  return_target *m_return_target = nullptr;
 
 private:
   std::unordered_map<const frontend::ast::function_definition *, unsigned> m_function_defs;
@@ -189,9 +318,11 @@ private:
   codegen_stack_block m_global_scope; // Global scope stack variable distribution.
   codegen_stack_frame m_symtab_stack;
 
+  frame_layout m_frame;        // Slot distribution for the function being generated.
+  unsigned m_frame_origin = 0; // Stack position of the first frame slot (after parameters).
+
   builder_type m_builder;
 
-  unsigned m_prev_stack_size = 0;
   bool m_is_currently_statement = false;
 
 private:
@@ -200,7 +331,10 @@ private:
   bool is_currently_statement() const { return m_is_currently_statement; }
 
   void visit_if_no_else(const frontend::ast::if_statement &);
+  void generate_tail_call(const frontend::ast::function_call &);
   void visit_if_with_else(const frontend::ast::if_statement &);
+  void generate_block_return(const frontend::ast::return_statement &);
+  template <typename t_block> void generate_statements(const t_block &, bool global_scope);
 
   unsigned lookup_or_insert_constant(int constant);
 
@@ -223,28 +357,50 @@ private:
   auto emit(auto &&desc) { return m_builder.emit_operation(desc); }
   void emit_pop() { emit_with_decrement(vm_instruction_set::pop_desc); }
 
+  void add_profile_point(
+      bytecode_vm::decl_vm::profile_point::kind_type kind, const ast::i_ast_node &ref
+  ) {
+    auto pos = ref.loc().begin;
+    m_profile_points.push_back({m_builder.current_loc(), kind, pos.line, pos.column});
+  }
+
+  // Jump over the body of an `if` or a `while`, counted as the branch of the statement.
+  auto emit_condition_jump(const ast::i_ast_node &ref) {
+    add_profile_point(bytecode_vm::decl_vm::profile_point::E_BRANCH, ref);
+    return emit_with_decrement(encoded_instruction{vm_instruction_set::jmp_false_desc, 0});
+  }
+
   // clang-format off
   void increment_stack() { m_symtab_stack.push_dummy(); }
   void decrement_stack() { m_symtab_stack.pop_dummy(); }
   // clang-format on
 
+  // Scopes don't emit any code, their variables live in slots preallocated by begin_frame.
   void begin_scope(const frontend::symtab &stab) {
-    m_symtab_stack.begin_scope(stab);
-    for (unsigned i = 0; i < stab.size(); ++i) {
-      emit(encoded_instruction{vm_instruction_set::push_const_desc, lookup_or_insert_constant(0)});
-    }
+    m_symtab_stack.begin_scope(stab, m_frame_origin + m_frame.base(stab));
   }
 
-  void end_scope() {
-    auto current_size = m_symtab_stack.size();
-    m_symtab_stack.end_scope();
-    auto old_size = m_symtab_stack.size();
+  void end_scope() { m_symtab_stack.end_scope(); }
 
-    assert(current_size >= old_size);
+  // Function prologue. Every variable in ParaCL is declared by its first assignment, so a slot is
+  // always written before it is read in its scope. Zeroing the whole frame once is thus enough,
+  // even when sibling scopes and loop iterations reuse the same slots.
+  void begin_frame(const ast::i_ast_node &body) {
+    m_frame = frame_layout_builder{}.build(body);
+    m_frame_origin = m_symtab_stack.size();
+    for (unsigned i = 0; i < m_frame.size(); ++i) {
+      emit_with_increment(
+          encoded_instruction{vm_instruction_set::push_const_desc, lookup_or_insert_constant(0)}
+      );
+    }
+  }
 
-    for (unsigned i = 0; i < current_size - old_size; ++i) {
-      emit(vm_instruction_set::pop_desc);
+  // Function epilogue. Cleans up everything left in the frame: parameters, locals and the result.
+  void end_frame() {
+    for (unsigned i = 0, size = m_symtab_stack.size(); i < size; ++i) {
+      emit_pop();
     }
+    m_symtab_stack.end_scope();
   }
 
 private:
@@ -262,6 +418,8 @@ public:
 
   codegen_visitor() = default;
 
+  void set_memoization(bool memoize) { m_memoize = memoize; }
+
   void generate(const frontend::ast::assignment_statement &);
   void generate(const frontend::ast::binary_expression &);
   void generate(const frontend::ast::constant_expression &);
@@ -279,7 +437,7 @@ public:
 
   EZVIS_VISIT_INVOKER(generate);
 
-  unsigned generate_function(const frontend::ast::function_definition &);
+  unsigned generate_function(const frontend::ast::function_definition &, bool memoized = false);
   void generate_all(
       const frontend::ast::ast_container &ast, const frontend::functions_analytics &functions
   );
@@ -315,6 +473,7 @@ void codegen_visitor::generate(const ast::print_statement &ref) {
 
 void codegen_visitor::generate(const ast::assignment_statement &ref) {
   const bool emit_push = !is_currently_statement();
+  reset_currently_statement(); // Assignments nested in the right side are expressions
   apply(ref.right());
 
   auto move_to_location = [this](std::string_view name) {
@@ -377,158 +536,92 @@ void codegen_visitor::generate(const ast::binary_expression &ref) {
   }
 }
 
-void codegen_visitor::generate(const ast::value_block &ref, bool global_scope) {
-  bool should_return = ref.type != frontend::types::type_builtin::type_void;
-
-  unsigned ret_addr_index = 0;
-  unsigned prev_stack_size = m_prev_stack_size;
-
-  if (should_return) {
-    const auto const_index = current_constant_index();
-    m_return_address_constants.push_back({const_index, 0}); // Dummy address
-    ret_addr_index = m_return_address_constants.size() - 1;
-
-    m_symtab_stack.begin_scope(); // scope to isolate IP and SP
-    emit_with_increment(encoded_instruction{vm_instruction_set::push_const_desc, const_index});
-    emit_with_increment(vm_instruction_set::setup_call_desc);
-
-    m_prev_stack_size = m_symtab_stack.size();
-  }
-
+template <typename t_block>
+void codegen_visitor::generate_statements(const t_block &ref, bool global_scope) {
   begin_scope(ref.stab);
 
-  if (ref.size()) {
-    for (auto st_ptr : ref) {
-      assert(st_ptr && "Broken statement pointer");
-      using frontend::ast::ast_expression_types;
-      auto &st = *st_ptr;
-
-      const auto node_type = frontend::ast::identify_node(st);
-      const auto is_expression =
-          std::find(ast_expression_types.begin(), ast_expression_types.end(), node_type) !=
-          ast_expression_types.end();
-
-      bool is_assignment = (node_type == frontend::ast::ast_node_type::E_ASSIGNMENT_STATEMENT);
-      bool is_return = (node_type == frontend::ast::ast_node_type::E_RETURN_STATEMENT);
-      bool pop_unused_result = is_expression && !is_return;
-
-      using expressions_and_base =
-          utils::tuple_add_types_t<ast::tuple_expression_nodes, ast::i_ast_node>;
-      auto type = ezvis::visit_tuple<frontend::types::generic_type, expressions_and_base>(
-          ::utils::visitors{
-              [](ast::i_expression &expr) { return expr.type; },
-              [](ast::i_ast_node &) { return frontend::types::type_builtin::type_void; }
-          },
-          st
-      );
+  for (auto st_ptr : ref) {
+    assert(st_ptr && "Broken statement pointer");
+    using frontend::ast::ast_expression_types;
+    auto &st = *st_ptr;
+
+    const auto node_type = frontend::ast::identify_node(st);
+    const auto is_expression =
+        std::find(ast_expression_types.begin(), ast_expression_types.end(), node_type) !=
+        ast_expression_types.end();
+
+    bool is_assignment = (node_type == frontend::ast::ast_node_type::E_ASSIGNMENT_STATEMENT);
+    bool is_return = (node_type == frontend::ast::ast_node_type::E_RETURN_STATEMENT);
+    bool pop_unused_result = is_expression && !is_return;
+
+    using expressions_and_base =
+        utils::tuple_add_types_t<ast::tuple_expression_nodes, ast::i_ast_node>;
+    auto type = ezvis::visit_tuple<frontend::types::generic_type, expressions_and_base>(
+        ::utils::visitors{
+            [](ast::i_expression &expr) { return expr.type; },
+            [](ast::i_ast_node &) { return frontend::types::type_builtin::type_void; }
+        },
+        st
+    );
 
-      if (is_assignment && pop_unused_result) {
-        set_currently_statement();
-      } else {
-        reset_currently_statement();
-      }
+    if (is_assignment && pop_unused_result) {
+      set_currently_statement();
+    } else {
+      reset_currently_statement();
+    }
 
-      if (node_type != ast::ast_node_type::E_FUNCTION_DEFINITION) {
-        apply(st);
-      }
+    if (node_type != ast::ast_node_type::E_FUNCTION_DEFINITION) {
+      apply(st);
+    }
 
-      if ((!is_assignment) && (pop_unused_result) &&
-          (type != frontend::types::type_builtin::type_void)) {
-        emit_pop();
-      }
+    if ((!is_assignment) && (pop_unused_result) &&
+        (type != frontend::types::type_builtin::type_void)) {
+      emit_pop();
     }
   }
 
-  if (global_scope) m_global_scope = m_symtab_stack.front();
+  if (global_scope) m_global_scope = m_symtab_stack.back();
   end_scope();
-
-  if (should_return) {
-    m_return_address_constants.at(ret_addr_index).m_address = m_builder.current_loc();
-    m_prev_stack_size = prev_stack_size;
-    m_symtab_stack.end_scope(); // end scope for IP and SP
-    emit_with_increment(vm_instruction_set::store_r0_desc);
-  }
 }
 
-void codegen_visitor::generate(const ast::statement_block &ref, bool global_scope) {
-  bool should_return = false;
-
-  unsigned ret_addr_index = 0;
-  unsigned prev_stack_size = m_prev_stack_size;
+// Value blocks are generated inline. Every path leaves the result on the top of the stack and
+// jumps to the end of the block, no return address or stack pointer is saved. The body of a
+// function is the only block whose returns go back to the caller.
+void codegen_visitor::generate(const ast::value_block &ref, bool global_scope) {
+  const bool has_value = (ref.type != frontend::types::type_builtin::type_void);
+  const bool function_body = (m_curr_function && &ref == &m_curr_function->body());
 
-  if (should_return) {
-    const auto const_index = current_constant_index();
-    m_return_address_constants.push_back({const_index, 0}); // Dummy address
-    ret_addr_index = m_return_address_constants.size() - 1;
+  return_target target = {&ref, m_symtab_stack.size(), {}, function_body};
+  auto *prev_target = std::exchange(m_return_target, &target);
+  if (function_body) m_body_start = m_builder.current_loc();
 
-    m_symtab_stack.begin_scope(); // scope to isolate IP and SP
-    emit_with_increment(encoded_instruction{vm_instruction_set::push_const_desc, const_index});
-    emit_with_increment(vm_instruction_set::setup_call_desc);
+  generate_statements(ref, global_scope);
+  m_return_target = prev_target;
+  if (function_body) return;
 
-    m_prev_stack_size = m_symtab_stack.size();
+  const bool ends_with_return =
+      ref.size() && ast::identify_node(*ref.back()) == ast::ast_node_type::E_RETURN_STATEMENT;
+  if (has_value && !ends_with_return) { // Falls through the end without a value
+    emit(encoded_instruction{vm_instruction_set::push_const_desc, lookup_or_insert_constant(0)});
   }
 
-  begin_scope(ref.stab);
-
-  if (ref.size()) {
-    for (auto st_ptr : ref) {
-      assert(st_ptr && "Broken statement pointer");
-      using frontend::ast::ast_expression_types;
-      auto &st = *st_ptr;
-
-      const auto node_type = frontend::ast::identify_node(st);
-      const auto is_expression =
-          std::find(ast_expression_types.begin(), ast_expression_types.end(), node_type) !=
-          ast_expression_types.end();
-
-      bool is_assignment = (node_type == frontend::ast::ast_node_type::E_ASSIGNMENT_STATEMENT);
-      bool is_return = (node_type == frontend::ast::ast_node_type::E_RETURN_STATEMENT);
-      bool pop_unused_result = is_expression && !is_return;
-
-      using expressions_and_base =
-          utils::tuple_add_types_t<ast::tuple_expression_nodes, ast::i_ast_node>;
-      auto type = ezvis::visit_tuple<frontend::types::generic_type, expressions_and_base>(
-          ::utils::visitors{
-              [](ast::i_expression &expr) { return expr.type; },
-              [](ast::i_ast_node &) { return frontend::types::type_builtin::type_void; }
-          },
-          st
-      );
-
-      if (is_assignment && pop_unused_result) {
-        set_currently_statement();
-      } else {
-        reset_currently_statement();
-      }
-
-      if (node_type != ast::ast_node_type::E_FUNCTION_DEFINITION) {
-        apply(st);
-      }
-
-      if ((!is_assignment) && (pop_unused_result) &&
-          (type != frontend::types::type_builtin::type_void)) {
-        emit_pop();
-      }
-    }
+  for (auto index : target.m_exit_jumps) {
+    auto &to_relocate = m_builder.get_as(vm_instruction_set::jmp_desc, index);
+    std::get<0>(to_relocate.m_attr) = m_builder.current_loc();
   }
 
-  if (global_scope) m_global_scope = m_symtab_stack.front();
-  end_scope();
+  if (has_value) increment_stack();
+}
 
-  if (should_return) {
-    m_return_address_constants.at(ret_addr_index).m_address = m_builder.current_loc();
-    m_prev_stack_size = prev_stack_size;
-    m_symtab_stack.end_scope(); // end scope for IP and SP
-    emit_with_increment(vm_instruction_set::store_r0_desc);
-  }
+void codegen_visitor::generate(const ast::statement_block &ref, bool global_scope) {
+  generate_statements(ref, global_scope);
 }
 
 void codegen_visitor::visit_if_no_else(const ast::if_statement &ref) {
   reset_currently_statement();
   apply(*ref.cond());
 
-  auto index_jmp_to_false_block =
-      emit_with_decrement(encoded_instruction{vm_instruction_set::jmp_false_desc, 0});
+  auto index_jmp_to_false_block = emit_condition_jump(ref);
 
   set_currently_statement();
   apply(*ref.true_block());
@@ -544,8 +637,7 @@ void codegen_visitor::visit_if_with_else(const ast::if_statement &ref) {
   reset_currently_statement();
   apply(*ref.cond());
 
-  auto index_jmp_to_false_block =
-      emit_with_decrement(encoded_instruction{vm_instruction_set::jmp_false_desc, 0});
+  auto index_jmp_to_false_block = emit_condition_jump(ref);
 
   set_currently_statement();
   apply(*ref.true_block());
@@ -582,8 +674,7 @@ void codegen_visitor::generate(const ast::while_statement &ref) {
   reset_currently_statement();
   apply(*ref.cond());
 
-  auto index_jmp_to_after_loop =
-      emit_with_decrement(encoded_instruction{vm_instruction_set::jmp_false_desc, 0});
+  auto index_jmp_to_after_loop = emit_condition_jump(ref);
   set_currently_statement();
 
   apply(*ref.block());
@@ -667,31 +758,101 @@ void codegen_visitor::generate(const ast::function_call &ref) {
   }
 }
 
+// Calls marked by tail_call_marker reuse the frame of the current function. A call to the function
+// itself becomes a jump to the start of its body, any other one is done with `tail_call`.
+void codegen_visitor::generate_tail_call(const ast::function_call &ref) {
+  const unsigned n_args = ref.size();
+  for (auto &&e : ref) {
+    assert(e);
+    apply(*e);
+  }
+
+  if (ref.m_def == m_curr_function) {
+    for (unsigned i = n_args; i-- > 0;) {
+      emit_with_decrement(encoded_instruction{vm_instruction_set::mov_local_rel_desc, int(i)});
+    }
+
+    unsigned local_var_n = m_symtab_stack.size() - m_return_target->m_stack_size;
+    for (unsigned i = 0; i < local_var_n; ++i) {
+      emit(encoded_instruction{vm_instruction_set::pop_desc});
+    }
+
+    emit(encoded_instruction{vm_instruction_set::jmp_desc, m_body_start});
+    return;
+  }
+
+  if (ref.m_def) {
+    const auto const_index = current_constant_index();
+    m_dynamic_jumps_constants.push_back({const_index, 0, ref.m_def}); // Dummy address
+    emit_with_increment(encoded_instruction{vm_instruction_set::push_const_desc, const_index});
+  } else {
+    int pos = m_symtab_stack.lookup_location(ref.name()).value();
+    emit_with_increment(encoded_instruction{vm_instruction_set::push_local_rel_desc, pos});
+  }
+
+  emit(encoded_instruction{vm_instruction_set::tail_call_desc, n_args});
+
+  // Control never gets past the tail call, so just forget about the pushed values.
+  for (unsigned i = 0; i < n_args + 1; ++i) {
+    decrement_stack();
+  }
+}
+
 void codegen_visitor::generate(const frontend::ast::return_statement &ref) {
-  if (!ref.empty()) {
-    apply(ref.expr());
-    emit_with_decrement(vm_instruction_set::load_r0_desc);
+  if (!ref.empty() && ast::identify_node(ref.expr()) == ast::ast_node_type::E_FUNCTION_CALL) {
+    auto &call = static_cast<const ast::function_call &>(ref.expr());
+    // Memoized functions have to store the result before returning, only self calls are fine.
+    const bool frame_reusable = !m_curr_memoized || call.m_def == m_curr_function;
+    const bool leaves_function = m_return_target && m_return_target->m_function_body;
+    if (call.m_tail_call && leaves_function && frame_reusable &&
+        call.type != frontend::types::type_builtin::type_void) {
+      return generate_tail_call(call);
+    }
   }
 
-  // clean up local variables
-  unsigned local_var_n = m_symtab_stack.size() - m_prev_stack_size;
-  for (unsigned i = 0; i < local_var_n; ++i) {
+  if (m_return_target && !m_return_target->m_function_body) return generate_block_return(ref);
+
+  const bool has_value =
+      !ref.empty() && ref.expr().type != frontend::types::type_builtin::type_void;
+  if (!ref.empty()) apply(ref.expr());
+  if (has_value) emit_with_decrement(vm_instruction_set::load_r0_desc);
+  if (m_curr_memoized) emit(vm_instruction_set::memo_store_desc);
+
+  // Clean up the whole frame, including the parameters
+  for (unsigned i = 0, size = m_symtab_stack.size(); i < size; ++i) {
     emit(encoded_instruction{vm_instruction_set::pop_desc});
   }
 
   emit(encoded_instruction{vm_instruction_set::return_desc});
 }
 
+// Statements of a value block are generated with nothing on the stack above the start of the
+// block, so the result of a return is already where the block leaves it.
+void codegen_visitor::generate_block_return(const ast::return_statement &ref) {
+  auto &target = *m_return_target;
+  assert(m_symtab_stack.size() == target.m_stack_size && "Temporaries left under a return");
+
+  if (!ref.empty()) {
+    apply(ref.expr());
+    if (ref.expr().type != frontend::types::type_builtin::type_void) decrement_stack();
+  }
+
+  if (&ref == target.m_block->back()) return; // Falls through to the end of the block
+  target.m_exit_jumps.push_back(emit(encoded_instruction{vm_instruction_set::jmp_desc, 0}));
+}
+
 void codegen_visitor::generate(const frontend::ast::function_definition_to_ptr_conv &ref) {
   const auto const_index = current_constant_index();
   m_dynamic_jumps_constants.push_back({const_index, 0, &ref.definition()}); // Dummy address
   emit_with_increment(encoded_instruction{vm_instruction_set::push_const_desc, const_index});
 }
 
-unsigned codegen_visitor::generate_function(const frontend::ast::function_definition &ref) {
+unsigned
+codegen_visitor::generate_function(const frontend::ast::function_definition &ref, bool memoized) {
   m_symtab_stack.clear();
 
   m_curr_function = &ref;
+  m_curr_memoized = memoized;
   m_symtab_stack.begin_scope();
   for (auto &&param : ref) {
     m_symtab_stack.push_var(param.name());
@@ -699,9 +860,31 @@ unsigned codegen_visitor::generate_function(const frontend::ast::function_defini
 
   auto &&function_pos = m_builder.current_loc();
   m_function_defs.insert({&ref, function_pos});
+  add_profile_point(bytecode_vm::decl_vm::profile_point::E_ENTRY, ref);
+
+  if (memoized) {
+    const unsigned n_params = ref.size();
+    emit_with_increment(
+        encoded_instruction{vm_instruction_set::memo_lookup_desc, m_memoized_count++, n_params}
+    );
+    auto index_jmp_to_miss =
+        emit_with_decrement(encoded_instruction{vm_instruction_set::jmp_false_desc, 0});
+
+    // Cache hit, the result is already in r0 and only the parameters are on the frame.
+    for (unsigned i = 0; i < n_params; ++i) {
+      emit(encoded_instruction{vm_instruction_set::pop_desc});
+    }
+    emit(encoded_instruction{vm_instruction_set::return_desc});
+
+    auto &to_relocate = m_builder.get_as(vm_instruction_set::jmp_false_desc, index_jmp_to_miss);
+    std::get<0>(to_relocate.m_attr) = m_builder.current_loc();
+  }
+
+  begin_frame(ref.body());
   apply(ref.body());
+  if (memoized) emit(vm_instruction_set::memo_store_desc); // The result is left in r0 by the body
+  end_frame();
 
-  end_scope();
   emit(encoded_instruction{vm_instruction_set::return_desc});
 
   return function_pos;
@@ -729,17 +912,25 @@ void codegen_visitor::generate_all(
   m_return_address_constants.clear();
   m_functions = &functions;
 
-  if (ast.get_root_ptr()) { // clang-format off
+  if (ast.get_root_ptr()) {
+    m_symtab_stack.clear();
+    m_symtab_stack.begin_scope();
+    begin_frame(*ast.get_root_ptr());
+
+    // clang-format off
     ezvis::visit<void, frontend::ast::statement_block>(
       [this](auto &st) { generate(st, true);  }, 
       *ast.get_root_ptr()
     ); // clang-format on
+
+    end_frame();
   }
 
   emit(vm_instruction_set::return_desc); // Last instruction is ret
   for (auto &&[name, attr] : functions.named_functions) {
     assert(attr.definition && "Attribute definition pointer can't be nullptr");
-    generate_function(*attr.definition);
+    const bool memoized = m_memoize && frontend::purity_analyzer::is_memoizable(attr);
+    generate_function(*attr.definition, memoized);
   }
 
   for (auto &&reloc : m_relocations_function_calls) {
@@ -773,6 +964,7 @@ paracl::bytecode_vm::decl_vm::chunk codegen_visitor::to_chunk() {
   }
 
   ch.set_constant_pool(std::move(constants));
+  ch.set_profile_points(m_profile_points);
   return ch;
 }
 
@@ -0,0 +1,114 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <cassert>
+#include <utility>
+#include <variant>
+
+namespace paracl::frontend {
+
+// Collects the names that can change while a piece of code runs, used by the loop passes.
+class assignment_collector final
+    : public ezvis::visitor_base<const ast::i_ast_node, assignment_collector, void> {
+  const functions_analytics &m_functions;
+  utils::transparent::string_unordered_set m_assigned;
+  bool m_impure_calls = false;
+
+private:
+  bool is_pure(const ast::function_definition &def) const {
+    if (!def.name) return false;
+    auto found = m_functions.named_functions.lookup(def.name.value());
+    return found && found->pure;
+  }
+
+  template <typename t_block> void collect_block(const t_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+public:
+  assignment_collector(const functions_analytics &functions) : m_functions{functions} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(const ast::statement_block &ref) { collect_block(ref); }
+  void collect(const ast::value_block &ref) { collect_block(ref); }
+
+  void collect(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      std::visit([this](auto &&var) { m_assigned.emplace(var.name()); }, left);
+    }
+    apply(ref.right());
+  }
+
+  void collect(const ast::function_call &ref) {
+    if (!ref.m_def || !is_pure(*ref.m_def)) m_impure_calls = true;
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void collect(const ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void collect(const ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void collect(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void collect(const ast::print_statement &ref) { apply(ref.expr()); }
+  void collect(const ast::unary_expression &ref) { apply(ref.expr()); }
+  void collect(const ast::subscript &ref) { apply(*ref.get_subscript()); }
+
+  void collect(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void collect(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+
+  // Names assigned by the nodes applied so far, impure calls are assumed to assign every global.
+  utils::transparent::string_unordered_set take_assigned() {
+    if (m_impure_calls && m_functions.global_stab) {
+      for (const auto &[name, attr] : *m_functions.global_stab) {
+        m_assigned.emplace(name);
+      }
+    }
+    return std::move(m_assigned);
+  }
+
+  utils::transparent::string_unordered_set collect_all(const ast::i_ast_node &ref) {
+    apply(ref);
+    return take_assigned();
+  }
+};
+
+} // namespace paracl::frontend
@@ -0,0 +1,33 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+
+namespace paracl::frontend {
+
+// Removes array bounds checks that can never fail. A value-range analysis computes an interval for
+// every integer variable, refined by the conditions of ifs and loops, and subscripts whose index
+// always lies inside of the array are marked as such. A counting loop `while (i < n)` with
+// subscripts like `a[i + c]` that are only in range for small enough `n` is versioned: a copy
+// without those checks runs when a single comparison of `n` before the loop succeeds. Has to run
+// after the purity_analyzer.
+class bounds_check_eliminator final {
+public:
+  static constexpr unsigned max_versioned_size = 256; // Size of a versioned loop in AST nodes
+
+public:
+  // Returns the number of subscripts that don't need a check.
+  unsigned eliminate(ast::ast_container &ast, const functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
@@ -0,0 +1,92 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace paracl::frontend {
+
+// Local value numbering over the straight-line statements of every block. Expressions are hashed by
+// structure, the first occurrence of a repeated one becomes an assignment to a `$cse-N` temporary
+// of the block and the following ones read that temporary. A number is forgotten when one of its
+// variables is assigned and after `?`, impure calls, loops and conditionals. Has to run after the
+// purity_analyzer.
+class common_subexpression_eliminator final
+    : public ezvis::visitor_base<ast::i_ast_node, common_subexpression_eliminator, void> {
+public:
+  using replace_function = std::function<void(ast::i_expression &)>;
+
+private:
+  struct value_number {
+    ast::i_expression *first;            // First occurrence of the expression
+    replace_function replace_first;      // Puts a node in place of the first occurrence
+    std::string temporary;               // Empty while the expression is only computed once
+    std::vector<std::string> variables;  // The value is forgotten when one of these changes
+  };
+
+  ast::ast_container *m_ast = nullptr;
+  const functions_analytics *m_functions = nullptr;
+  symtab *m_stab = nullptr; // Symbol table of the block being processed
+  utils::transparent::string_unordered_map<value_number> m_numbers;
+  unsigned m_temporaries = 0;
+  unsigned m_eliminated = 0;
+
+private:
+  template <typename t_block> void eliminate_in_block(t_block &ref);
+
+  void process_expr(ast::i_expression &ref, const replace_function &replace);
+  void process_children(ast::i_expression &ref);
+  void forget(std::string_view variable);
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void eliminate_node(ast::statement_block &ref) {
+    eliminate_in_block(ref);
+    m_numbers.clear(); // Assignments in the block could change any of the outer values
+  }
+
+  void eliminate_node(ast::value_block &ref) { eliminate_in_block(ref); }
+
+  void eliminate_node(ast::if_statement &ref);
+  void eliminate_node(ast::while_statement &ref);
+  void eliminate_node(ast::assignment_statement &ref);
+
+  void eliminate_node(ast::print_statement &ref) {
+    process_expr(ref.expr(), [&ref](auto &expr) { ref.set_expr(expr); });
+  }
+
+  void eliminate_node(ast::return_statement &ref) {
+    if (!ref.empty()) process_expr(ref.expr(), [&ref](auto &expr) { ref.set_expr(expr); });
+  }
+
+  // Function bodies are handled separately, see eliminate_all.
+  void eliminate_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(eliminate_node);
+
+public:
+  // Returns the number of eliminated computations.
+  unsigned eliminate_all(ast::ast_container &ast, const functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
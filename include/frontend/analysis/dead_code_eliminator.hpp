@@ -0,0 +1,87 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <unordered_set>
+
+namespace paracl::frontend {
+
+// Runs on a semantically correct AST before code generation. Removes statements that follow a
+// `return`, stores to variables that are never read and functions that can't be reached from main.
+class dead_code_eliminator final
+    : public ezvis::visitor_base<ast::i_ast_node, dead_code_eliminator, void> {
+private:
+  utils::transparent::string_unordered_set m_reads; // Names read anywhere in the program
+  bool m_changed = false;
+
+private:
+  bool is_dead_store(const ast::assignment_statement &) const;
+
+  template <typename t_block> void eliminate_in_block(t_block &);
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void eliminate_node(ast::statement_block &ref) { eliminate_in_block(ref); }
+  void eliminate_node(ast::value_block &ref) { eliminate_in_block(ref); }
+
+  void eliminate_node(ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void eliminate_node(ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void eliminate_node(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void eliminate_node(ast::assignment_statement &ref) { apply(ref.right()); }
+  void eliminate_node(ast::print_statement &ref) { apply(ref.expr()); }
+  void eliminate_node(ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void eliminate_node(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void eliminate_node(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void eliminate_node(ast::function_definition &ref) { apply(ref.body()); }
+  void eliminate_node(ast::function_definition_to_ptr_conv &ref) { apply(ref.definition()); }
+
+  void eliminate_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(eliminate_node);
+
+public:
+  // Returns the number of eliminated functions.
+  unsigned eliminate(ast::ast_container &ast, functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
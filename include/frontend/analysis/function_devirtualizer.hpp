@@ -0,0 +1,48 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace paracl::frontend {
+
+// Flow-insensitive points-to analysis of function-typed variables and parameters. Every variable
+// gets the set of functions that can reach it through assignments and call arguments. Calls through
+// a variable with a single possible target become direct calls. A direct call that passes a known
+// function to a parameter which is called through is redirected to a clone of the callee, where the
+// parameter has a single target. Has to run after the semantic analysis.
+class function_devirtualizer final {
+public:
+  static constexpr unsigned max_rounds = 4;  // Every round can devirtualize calls in new clones
+  static constexpr unsigned max_clones = 32; // Specializations of all functions in total
+
+private:
+  using specialization =
+      std::pair<const ast::function_definition *, std::vector<ast::function_definition *>>;
+  std::map<specialization, ast::function_definition *> m_clones;
+
+private:
+  ast::function_definition &clone(
+      ast::ast_container &ast, functions_analytics &functions, const specialization &key,
+      ast::function_definition *caller
+  );
+
+public:
+  // Returns the number of calls that became direct.
+  unsigned devirtualize(ast::ast_container &ast, functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
@@ -0,0 +1,109 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <unordered_map>
+
+namespace paracl::frontend {
+
+// Replaces calls to small non-recursive functions with a value block that contains a copy of the
+// callee's body. Parameters become fresh locals of that block and are initialized with the call
+// arguments. Works on the typed AST, so it has to run after the semantic analysis.
+class function_inliner final : public ezvis::visitor_base<ast::i_ast_node, function_inliner, void> {
+public:
+  static constexpr unsigned default_threshold = 32; // Max callee size in AST nodes
+  static constexpr unsigned max_rounds = 4; // Every round can turn callers into new candidates
+
+  struct candidate {
+    utils::transparent::string_unordered_set locals; // Parameters and all locals of the callee
+  };
+
+private:
+  std::unordered_map<const ast::function_definition *, candidate> m_candidates;
+  ast::ast_container *m_ast = nullptr;
+  unsigned m_threshold;
+  unsigned m_inlined = 0; // Also used to give unique names to the inlined locals
+
+private:
+  void find_candidates(const functions_analytics &functions);
+  ast::i_expression &inline_expr(ast::i_expression &);
+  ast::value_block &inline_call(const ast::function_call &, const ast::function_definition &);
+
+  template <typename t_block> void inline_in_block(t_block &ref) {
+    for (auto &st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      if (ast::identify_node(*st) == ast::ast_node_type::E_FUNCTION_CALL) {
+        st = &inline_expr(static_cast<ast::function_call &>(*st));
+        continue;
+      }
+      apply(*st);
+    }
+  }
+
+public:
+  function_inliner(unsigned threshold = default_threshold) : m_threshold{threshold} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void inline_node(ast::statement_block &ref) { inline_in_block(ref); }
+  void inline_node(ast::value_block &ref) { inline_in_block(ref); }
+
+  void inline_node(ast::if_statement &ref) {
+    ref.set_cond(inline_expr(*ref.cond()));
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void inline_node(ast::while_statement &ref) {
+    ref.set_cond(inline_expr(*ref.cond()));
+    apply(*ref.block());
+  }
+
+  void inline_node(ast::binary_expression &ref) {
+    ref.set_left(inline_expr(ref.left()));
+    ref.set_right(inline_expr(ref.right()));
+  }
+
+  void inline_node(ast::assignment_statement &ref) { ref.set_right(inline_expr(ref.right())); }
+  void inline_node(ast::print_statement &ref) { ref.set_expr(inline_expr(ref.expr())); }
+  void inline_node(ast::unary_expression &ref) { ref.set_expr(inline_expr(ref.expr())); }
+  void inline_node(ast::subscript &ref) { ref.set_subscript(inline_expr(*ref.get_subscript())); }
+
+  void inline_node(ast::return_statement &ref) {
+    if (!ref.empty()) ref.set_expr(inline_expr(ref.expr()));
+  }
+
+  void inline_node(ast::function_call &ref) {
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+      ref.set_parameter(i, inline_expr(**std::next(ref.begin(), i)));
+    }
+  }
+
+  // Function bodies are handled separately, see inline_calls.
+  void inline_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(inline_node);
+
+public:
+  // Returns the number of inlined call sites.
+  unsigned inline_calls(ast::ast_container &ast, const functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
@@ -0,0 +1,40 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+
+namespace paracl::frontend {
+
+// Interprocedural constant propagation. Direct calls that pass integer literals are redirected to a
+// clone of the callee where those parameters are replaced with the constants and folded. The clone
+// keeps the signature, so the call sites only change their callee. A set of constants is only
+// specialized when several calls use it or one of them is inside a loop, and the total size of the
+// clones is limited. Parameters assigned to in the callee are never bound.
+class function_specializer final {
+public:
+  static constexpr unsigned default_budget = 1024; // Total size of the clones in AST nodes
+  static constexpr unsigned max_callee_size = 256; // In AST nodes
+  static constexpr unsigned min_sites = 2;         // Calls outside of loops with the same constants
+
+private:
+  unsigned m_budget;
+  unsigned m_specialized = 0; // Also used to give unique names to the clones
+
+public:
+  function_specializer(unsigned budget = default_budget) : m_budget{budget} {}
+
+  // Returns the number of redirected call sites.
+  unsigned specialize(ast::ast_container &ast, functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
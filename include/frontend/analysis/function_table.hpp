@@ -27,6 +27,7 @@ public:
   struct function_attributes {
     ast::function_definition *definition = nullptr;
     bool recursive = false;
+    bool pure = false; // No side effects, the result only depends on the arguments
   };
 
 private:
@@ -50,6 +51,16 @@ public:
     // For some reason ::at does not work well with transparent comparators
   }
 
+  void set_pure(std::string_view name, bool pure) {
+    auto found = m_table.find(name);
+    if (found != m_table.end()) found->second.pure = pure;
+  }
+
+  void erase(std::string_view name) {
+    auto found = m_table.find(name);
+    if (found != m_table.end()) m_table.erase(found);
+  }
+
   auto begin() { return m_table.begin(); }
   auto end() { return m_table.end(); }
   auto begin() const { return m_table.cbegin(); }
@@ -63,6 +74,15 @@ struct functions_analytics final {
   function_table named_functions;
   usegraph_type usegraph;
   symtab *global_stab;
+
+  // Registers a function created by an optimization. The caller is nullptr for main.
+  void
+  add_function(ast::function_definition &def, ast::function_definition *caller, bool recursive) {
+    named_functions.define_function(def.name.value(), {&def, recursive});
+    const auto node = usegraph_type::value_type{def.name.value(), &def};
+    if (caller) usegraph.insert(node, usegraph_type::value_type{caller->name.value(), caller});
+    else usegraph.insert(node);
+  }
 };
 
 } // namespace paracl::frontend
\ No newline at end of file
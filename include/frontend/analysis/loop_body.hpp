@@ -0,0 +1,28 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+namespace paracl::frontend {
+
+// The parser wraps the braces of a loop body into one more block, looks through such wrappers.
+inline ast::statement_block &loop_body(const ast::while_statement &loop) {
+  auto *block = loop.block();
+  while (block->size() == 1 && !block->stab.size() &&
+         ast::identify_node(*block->front()) == ast::ast_node_type::E_STATEMENT_BLOCK) {
+    block = static_cast<ast::statement_block *>(block->front());
+  }
+  return *block;
+}
+
+} // namespace paracl::frontend
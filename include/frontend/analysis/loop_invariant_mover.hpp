@@ -0,0 +1,84 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+namespace paracl::frontend {
+
+// Loop-invariant code motion. Subexpressions of a while statement whose variables are not assigned
+// inside of the loop are computed once before it and stored to a temporary of the enclosing block.
+// Calls to impure functions are assumed to assign every global. Since the loop body might not run
+// at all, only expressions that can't fail are hoisted: no division, subscripts or calls. Has to run
+// after the purity_analyzer.
+class loop_invariant_mover final
+    : public ezvis::visitor_base<ast::i_ast_node, loop_invariant_mover, void> {
+private:
+  ast::ast_container *m_ast = nullptr;
+  const functions_analytics *m_functions = nullptr;
+  unsigned m_hoisted = 0; // Also used to give unique names to the temporaries
+
+private:
+  template <typename t_block> void move_in_block(t_block &ref);
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void move_node(ast::statement_block &ref) { move_in_block(ref); }
+  void move_node(ast::value_block &ref) { move_in_block(ref); }
+
+  void move_node(ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void move_node(ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void move_node(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void move_node(ast::assignment_statement &ref) { apply(ref.right()); }
+  void move_node(ast::print_statement &ref) { apply(ref.expr()); }
+  void move_node(ast::unary_expression &ref) { apply(ref.expr()); }
+  void move_node(ast::subscript &ref) { apply(*ref.get_subscript()); }
+
+  void move_node(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void move_node(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  // Function bodies are handled separately, see hoist_all.
+  void move_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(move_node);
+
+public:
+  // Returns the number of hoisted expressions.
+  unsigned hoist_all(ast::ast_container &ast, const functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
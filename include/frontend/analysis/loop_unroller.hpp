@@ -0,0 +1,96 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+namespace paracl::frontend {
+
+// Transformations of counting loops. A while statement is a counting loop when its condition
+// compares a variable with a bound that doesn't change in the loop and its last statement steps
+// the variable by a constant, e.g. `while (i < n) { ...; i = i + 1; }`.
+//
+// Products of the induction variable and a constant that are used several times in the body are
+// replaced with a temporary that is stepped along with the variable. Innermost counting loops then
+// get an unrolled copy placed before them, which runs `factor` iterations per check of the
+// condition while all of them fit before the bound. The original loop runs the rest. Has to run
+// after the purity_analyzer.
+class loop_unroller final : public ezvis::visitor_base<ast::i_ast_node, loop_unroller, void> {
+public:
+  static constexpr unsigned default_factor = 4;
+  static constexpr unsigned max_unrolled_size = 256; // Size of the unrolled body in AST nodes
+  static constexpr unsigned min_product_uses = 3;    // Below that an addition costs more
+
+private:
+  ast::ast_container *m_ast = nullptr;
+  const functions_analytics *m_functions = nullptr;
+  unsigned m_factor;
+  unsigned m_transformed = 0;
+  unsigned m_temporaries = 0; // Used to give unique names to the temporaries
+
+private:
+  template <typename t_block> void unroll_in_block(t_block &ref);
+
+public:
+  loop_unroller(unsigned factor = default_factor) : m_factor{factor} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void unroll_node(ast::statement_block &ref) { unroll_in_block(ref); }
+  void unroll_node(ast::value_block &ref) { unroll_in_block(ref); }
+
+  void unroll_node(ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void unroll_node(ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void unroll_node(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void unroll_node(ast::assignment_statement &ref) { apply(ref.right()); }
+  void unroll_node(ast::print_statement &ref) { apply(ref.expr()); }
+  void unroll_node(ast::unary_expression &ref) { apply(ref.expr()); }
+  void unroll_node(ast::subscript &ref) { apply(*ref.get_subscript()); }
+
+  void unroll_node(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void unroll_node(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  // Function bodies are handled separately, see unroll_all.
+  void unroll_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(unroll_node);
+
+public:
+  // Returns the number of transformed loops. A factor of 1 disables unrolling.
+  unsigned unroll_all(ast::ast_container &ast, const functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
@@ -0,0 +1,39 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/ast/ast_container.hpp"
+
+namespace paracl::frontend {
+
+// Runs the top-level statements of main that come before the first `?` at compile time. The
+// evaluated statements are replaced with prints of the produced output followed by assignments of
+// the final values to the global variables. Evaluation stops at the first statement that reads
+// input, traps, returns from main, writes to a large global array or runs out of budget; that
+// statement and the rest are kept.
+class partial_evaluator final {
+public:
+  static constexpr unsigned default_budget = 1'000'000; // Evaluated statements, iterations and calls
+  static constexpr unsigned max_prints = 4096;          // Every print becomes a statement
+  static constexpr unsigned max_depth = 256;            // Nested calls
+  static constexpr unsigned max_baked_array = 256;      // Elements of a written global array
+
+private:
+  unsigned m_budget;
+
+public:
+  partial_evaluator(unsigned budget = default_budget) : m_budget{budget} {}
+
+  // Returns the number of evaluated top-level statements.
+  unsigned evaluate(ast::ast_container &ast);
+};
+
+} // namespace paracl::frontend
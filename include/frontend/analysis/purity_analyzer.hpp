@@ -0,0 +1,29 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+
+namespace paracl::frontend {
+
+// Finds the functions whose result only depends on their arguments: no `print`, no `?`, no access
+// to globals or arrays, and only direct calls to other pure functions. Mutually recursive functions
+// are assumed to be pure until one of them turns out not to be.
+class purity_analyzer final {
+public:
+  // Sets function_attributes::pure. Returns the number of pure functions.
+  unsigned analyze(functions_analytics &functions);
+
+  // Pure functions that take and return `int` only. Calls to these can be memoized.
+  static bool is_memoizable(const function_table::function_attributes &attr);
+};
+
+} // namespace paracl::frontend
@@ -45,6 +45,10 @@ private:
   // Vector of return statements in the current functions.
   ast::return_vector *m_return_statements = nullptr;
 
+  // Set when the statement being analyzed is the last one executed by the enclosing value block.
+  // Only statements in tail position can become implicit returns.
+  bool m_tail_position = false;
+
 private:
   bool m_type_errors_allowed = false; // Flag used to indicate that a type mismatch is not an error.
   // Set this flag to true when doing a first pass on recurisive functions.
@@ -0,0 +1,52 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+namespace paracl::frontend {
+
+// Sets function_call::m_tail_call on calls whose value is directly returned from a function. A
+// `return` in a nested value block only leaves that block, so nested value blocks are skipped.
+class tail_call_marker final : public ezvis::visitor_base<ast::i_ast_node, tail_call_marker, void> {
+private:
+  unsigned m_marked = 0;
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void mark(ast::statement_block &ref) {
+    for (auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  void mark(ast::if_statement &ref) {
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void mark(ast::while_statement &ref) { apply(*ref.block()); }
+  void mark(ast::return_statement &);
+  void mark(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(mark);
+
+public:
+  // Returns the number of marked tail calls.
+  unsigned mark_all(functions_analytics &functions);
+};
+
+} // namespace paracl::frontend
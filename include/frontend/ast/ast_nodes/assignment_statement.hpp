@@ -58,6 +58,7 @@ public:
   auto rend() const { return m_lefts.cend(); }
 
   i_expression &right() const { return *m_right; }
+  void set_right(i_expression &right) { m_right = &right; }
 };
 
 } // namespace paracl::frontend::ast
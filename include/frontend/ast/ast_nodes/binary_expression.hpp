@@ -13,7 +13,10 @@
 #include "i_ast_node.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <exception>
+#include <limits>
+#include <optional>
 #include <stdexcept>
 
 namespace paracl::frontend::ast {
@@ -56,6 +59,34 @@ constexpr std::string_view binary_operation_to_string(binary_operation op) {
   std::terminate();
 }
 
+// Computes the operation the way the bytecode VM does, with wrapping arithmetic. Returns nullopt when
+// it would trap at runtime.
+constexpr std::optional<int> evaluate_binary_operation(binary_operation op, int lhs, int rhs) {
+  using bin_op = binary_operation;
+  const auto wrap = [](std::int64_t value) {
+    return static_cast<int>(static_cast<std::uint32_t>(value));
+  };
+  const bool traps = (rhs == 0 || (lhs == std::numeric_limits<int>::min() && rhs == -1));
+
+  switch (op) {
+  case bin_op::E_BIN_OP_ADD: return wrap(std::int64_t{lhs} + rhs);
+  case bin_op::E_BIN_OP_SUB: return wrap(std::int64_t{lhs} - rhs);
+  case bin_op::E_BIN_OP_MUL: return wrap(std::int64_t{lhs} * rhs);
+  case bin_op::E_BIN_OP_DIV: return traps ? std::nullopt : std::optional{lhs / rhs};
+  case bin_op::E_BIN_OP_MOD: return traps ? std::nullopt : std::optional{lhs % rhs};
+  case bin_op::E_BIN_OP_EQ: return lhs == rhs;
+  case bin_op::E_BIN_OP_NE: return lhs != rhs;
+  case bin_op::E_BIN_OP_GT: return lhs > rhs;
+  case bin_op::E_BIN_OP_LS: return lhs < rhs;
+  case bin_op::E_BIN_OP_GE: return lhs >= rhs;
+  case bin_op::E_BIN_OP_LE: return lhs <= rhs;
+  case bin_op::E_BIN_OP_AND: return lhs && rhs;
+  case bin_op::E_BIN_OP_OR: return lhs || rhs;
+  }
+
+  return std::nullopt;
+}
+
 class binary_expression : public i_expression {
   binary_operation m_operation_type;
   i_expression *m_left, *m_right;
@@ -69,6 +100,10 @@ public:
   i_expression &left() const { return *m_left; }
   i_expression &right() const { return *m_right; }
 
+  void set_left(i_expression &left) { m_left = &left; }
+  void set_right(i_expression &right) { m_right = &right; }
+
+
   binary_operation op_type() const { return m_operation_type; }
 };
 
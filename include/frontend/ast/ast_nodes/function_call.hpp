@@ -25,7 +25,8 @@ private:
   EZVIS_VISITABLE();
 
 public:
-  ast::function_definition *m_def;
+  ast::function_definition *m_def = nullptr;
+  bool m_tail_call = false; // Result is immediately returned from the enclosing function
 
   function_call(std::string name, location l, std::vector<i_expression *> params = {})
       : i_expression{l}, vector{std::move(params)}, m_name{std::move(name)} {}
@@ -43,6 +44,7 @@ public:
   auto end() const { return vector::end(); }
 
   void append_parameter(i_expression *ptr) { vector::push_back(ptr); }
+  void set_parameter(std::size_t index, i_expression &expr) { vector::at(index) = &expr; }
 
   auto *get_callee() const { return m_def; }
 };
@@ -36,6 +36,8 @@ public:
       : i_statement{l}, m_condition{&cond}, m_true_block{&true_block}, m_else_block{&else_block} {}
 
   i_expression *cond() const { return m_condition; }
+  void set_cond(i_expression &cond) { m_condition = &cond; }
+
   statement_block *true_block() const { return m_true_block; }
   statement_block *else_block() const { return m_else_block; }
 };
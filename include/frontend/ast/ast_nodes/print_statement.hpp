@@ -22,6 +22,7 @@ class print_statement : public i_statement {
 public:
   print_statement(i_expression &p_expr, location l) : i_statement{l}, m_expr{&p_expr} {}
   i_expression &expr() const { return *m_expr; }
+  void set_expr(i_expression &p_expr) { m_expr = &p_expr; }
 };
 
 } // namespace paracl::frontend::ast
\ No newline at end of file
@@ -37,6 +37,8 @@ public:
     return *m_expr;
   }
 
+  void set_expr(i_expression &p_expr) { m_expr = &p_expr; }
+
   types::generic_type type() const {
     if (!m_expr) return types::type_builtin::type_void;
     return m_expr->type;
@@ -49,7 +49,9 @@ public:
   using vector::crbegin;
   using vector::crend;
   using vector::end;
+  using vector::erase;
   using vector::front;
+  using vector::insert;
   using vector::size;
 };
 
@@ -83,7 +85,9 @@ public:
   using vector::crbegin;
   using vector::crend;
   using vector::end;
+  using vector::erase;
   using vector::front;
+  using vector::insert;
   using vector::size;
 };
 
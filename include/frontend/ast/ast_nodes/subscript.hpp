@@ -26,12 +26,15 @@ private:
   EZVIS_VISITABLE();
 
 public:
+  bool m_in_bounds = false; // The index is proven to be inside of the array, no check is needed
+
   subscript(std::string name, i_expression *sub, location l)
       : i_expression{l, types::type_builtin::type_int}, m_name{std::move(name)}, m_sub(sub) {}
 
   std::string_view name() const & { return m_name; }
 
   auto get_subscript() const { return m_sub; }
+  void set_subscript(i_expression &sub) { m_sub = &sub; }
 };
 
 } // namespace paracl::frontend::ast
@@ -14,6 +14,7 @@
 #include "location.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <exception>
 
 namespace paracl::frontend::ast {
@@ -38,6 +39,20 @@ constexpr std::string_view unary_operation_to_string(unary_operation op) {
   std::terminate();
 }
 
+// Computes the operation the way the bytecode VM does, negation wraps around.
+constexpr int evaluate_unary_operation(unary_operation op, int value) {
+  using unary_op = unary_operation;
+
+  switch (op) {
+  case unary_op::E_UN_OP_NEG: return static_cast<int>(0u - static_cast<std::uint32_t>(value));
+  case unary_op::E_UN_OP_POS: return value;
+  case unary_op::E_UN_OP_NOT: return !value;
+  }
+
+  assert(0);
+  std::terminate();
+}
+
 class unary_expression : public i_expression {
 private:
   unary_operation m_operation_type;
@@ -51,6 +66,7 @@ public:
 
   unary_operation op_type() const { return m_operation_type; }
   i_expression &expr() const { return *m_expr; }
+  void set_expr(i_expression &p_expr) { m_expr = &p_expr; }
 };
 
 } // namespace paracl::frontend::ast
\ No newline at end of file
@@ -31,6 +31,8 @@ public:
       : i_statement{l}, m_condition{&cond}, m_block{&block} {}
 
   i_expression *cond() const { return m_condition; }
+  void set_cond(i_expression &cond) { m_condition = &cond; }
+
   statement_block *block() const { return m_block; }
 };
 
@@ -0,0 +1,80 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "ezvis/ezvis.hpp"
+#include "frontend/ast/ast_nodes/i_ast_node.hpp"
+#include "frontend/symtab.hpp"
+#include "utils/transparent.hpp"
+
+#include <string>
+#include <string_view>
+
+namespace paracl::frontend::ast {
+
+class ast_container;
+
+// Deep copy of an analyzed subtree. Unlike ast_copier, it keeps the types, symbol tables and
+// resolved callees computed by the semantic analyzer. Names found in the rename map are replaced,
+// the rest are kept as is. Function definitions are shared between the copies.
+class typed_ast_copier final
+    : public ezvis::visitor_base<const i_ast_node, typed_ast_copier, i_ast_node &> {
+public:
+  using rename_map = utils::transparent::string_unordered_map<std::string>;
+
+private:
+  ast_container &m_container;
+  const rename_map &m_names;
+
+private:
+  std::string rename(std::string_view name) const;
+  symtab rename(const symtab &stab) const;
+
+  i_expression &copy_expr(const i_expression &ref) {
+    return static_cast<i_expression &>(apply(ref));
+  }
+
+  template <typename t_block> t_block &copy_block(const t_block &ref);
+
+public:
+  typed_ast_copier(ast_container &container, const rename_map &names)
+      : m_container{container}, m_names{names} {}
+
+  EZVIS_VISIT_CT(tuple_all_nodes)
+
+  statement_block &copy(const statement_block &);
+  value_block &copy(const value_block &);
+  constant_expression &copy(const constant_expression &);
+  read_expression &copy(const read_expression &);
+  variable_expression &copy(const variable_expression &);
+  subscript &copy(const subscript &);
+  binary_expression &copy(const binary_expression &);
+  unary_expression &copy(const unary_expression &);
+  assignment_statement &copy(const assignment_statement &);
+  print_statement &copy(const print_statement &);
+  return_statement &copy(const return_statement &);
+  if_statement &copy(const if_statement &);
+  while_statement &copy(const while_statement &);
+  function_call &copy(const function_call &);
+  function_definition_to_ptr_conv &copy(const function_definition_to_ptr_conv &);
+  i_ast_node &copy(const function_definition &);
+  i_ast_node &copy(const i_ast_node &);
+
+  EZVIS_VISIT_INVOKER(copy);
+};
+
+// Copies a function under a new name. The copy has its own parameters and body.
+function_definition &
+clone_function(const function_definition &def, std::string name, ast_container &container);
+
+} // namespace paracl::frontend::ast
+
+#include "ast_container.hpp"
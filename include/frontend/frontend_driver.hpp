@@ -11,9 +11,20 @@
 #pragma once
 
 #include "bison_paracl_parser.hpp"
+#include "frontend/analysis/bounds_check_eliminator.hpp"
+#include "frontend/analysis/common_subexpression_eliminator.hpp"
+#include "frontend/analysis/dead_code_eliminator.hpp"
+#include "frontend/analysis/function_devirtualizer.hpp"
+#include "frontend/analysis/function_inliner.hpp"
+#include "frontend/analysis/function_specializer.hpp"
+#include "frontend/analysis/loop_invariant_mover.hpp"
+#include "frontend/analysis/loop_unroller.hpp"
+#include "frontend/analysis/partial_evaluator.hpp"
 #include "frontend/analysis/function_explorer.hpp"
 #include "frontend/analysis/main_explorer.hpp"
+#include "frontend/analysis/purity_analyzer.hpp"
 #include "frontend/analysis/semantic_analyzer.hpp"
+#include "frontend/analysis/tail_call_marker.hpp"
 
 #include "frontend/ast/ast_container.hpp"
 #include "frontend/error.hpp"
@@ -85,6 +96,7 @@ private:
   std::unique_ptr<parser_driver> m_parsing_driver;
 
   functions_analytics m_functions;
+  unsigned m_unroll_factor = loop_unroller::default_factor;
 
 public:
   frontend_driver(std::filesystem::path input_path)
@@ -98,6 +110,7 @@ public:
   const functions_analytics &functions() const & { return m_functions; }
 
   void parse() { m_parsing_driver->parse(); }
+  void set_unroll_factor(unsigned factor) { m_unroll_factor = factor; }
 
   bool analyze() {
     auto &ast = m_parsing_driver->ast();
@@ -118,7 +131,41 @@ public:
       m_reporter.report_pretty_error(e);
     }
 
-    return errors.empty();
+    if (!errors.empty()) return false;
+
+    partial_evaluator evaluator;
+    evaluator.evaluate(ast);
+
+    function_devirtualizer devirtualizer;
+    devirtualizer.devirtualize(ast, m_functions);
+
+    function_specializer specializer;
+    specializer.specialize(ast, m_functions);
+
+    function_inliner inliner;
+    inliner.inline_calls(ast, m_functions);
+
+    dead_code_eliminator eliminator;
+    eliminator.eliminate(ast, m_functions);
+
+    purity_analyzer purity;
+    purity.analyze(m_functions);
+
+    loop_invariant_mover mover;
+    mover.hoist_all(ast, m_functions);
+
+    bounds_check_eliminator bounds;
+    bounds.eliminate(ast, m_functions);
+
+    loop_unroller unroller = {m_unroll_factor};
+    unroller.unroll_all(ast, m_functions);
+
+    common_subexpression_eliminator cse;
+    cse.eliminate_all(ast, m_functions);
+
+    tail_call_marker marker;
+    marker.mark_all(m_functions);
+    return true;
   }
 };
 
@@ -11,19 +11,38 @@
 #pragma once
 
 #include "frontend/frontend_driver.hpp"
+#include "utils/profile.hpp"
 
 #include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
 
+#include <cstdint>
 #include <memory>
+#include <string_view>
 
 namespace paracl::llvm_codegen {
 
-namespace intrinsics {
-void print(int32_t val);
+struct codegen_options {
+  bool memoize = false; // Cache the results of pure functions, see purity_analyzer
+  const utils::execution_profile *profile = nullptr; // Counts of a run, see pclvm --write-profile
+  bool debug_info = false; // DWARF line tables from the source locations of the statements
+};
 
-int32_t read();
-} // namespace intrinsics
+// Functions and variables of the program are named with this prefix, so that they can't bind to
+// main, libc or the runtime when a split makes them external, see partition.hpp.
+constexpr std::string_view symbol_prefix = "__pcl.";
 
-auto emit_llvm(const frontend::frontend_driver &drv, llvm::LLVMContext &ctx) -> std::unique_ptr<llvm::Module>;
+auto emit_llvm(const frontend::frontend_driver &drv, llvm::LLVMContext &ctx, const codegen_options &options = {})
+    -> std::unique_ptr<llvm::Module>;
+
+// Runs the default pipeline of the given level (0-3) on the module. The target machine, if any,
+// provides the cost model, the module is expected to have its data layout set for it.
+void optimize(llvm::Module &m, unsigned level, llvm::TargetMachine *tm = nullptr);
+
+// Sets the layout and the triple of the target, verifies the module and optimizes it.
+void optimize_for(llvm::Module &m, llvm::TargetMachine &tm, unsigned level);
+
+// Level of the machine code generator that matches a pipeline level.
+auto to_codegen_opt_level(unsigned level) -> llvm::CodeGenOpt::Level;
 
 } // namespace paracl::llvm_codegen
@@ -0,0 +1,39 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "llvm_codegen/object_cache.hpp"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <memory>
+
+namespace paracl::llvm_codegen {
+
+struct jit_options {
+  unsigned opt_level = 2;        // Level of the pipeline, see optimize
+  unsigned compile_threads = 0;  // 0 uses one thread per core
+  bool emit_llvm = false;        // Dump the IR after the pipeline
+  object_cache *cache = nullptr; // Reuse objects of the previous runs
+  bool perf_map = false;         // Write /tmp/perf-<pid>.map, and jitdump files if LLVM has them
+  bool debugger = false;         // Register the objects with GDB, see codegen_options::debug_info
+  unsigned partitions = 0;       // Parts compiled concurrently, 0 takes partition_count
+};
+
+// Optimizes the module for the host and runs its main. Functions are compiled on their first call,
+// or all up front when the module is partitioned.
+void run_jit(
+    std::unique_ptr<llvm::Module> m, std::unique_ptr<llvm::LLVMContext> ctx,
+    const jit_options &options = {}
+);
+
+} // namespace paracl::llvm_codegen
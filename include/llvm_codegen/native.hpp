@@ -0,0 +1,34 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <llvm/IR/Module.h>
+
+#include <filesystem>
+#include <string_view>
+
+namespace paracl::llvm_codegen {
+
+// The runtime library defines the C main and calls the program through this name.
+constexpr std::string_view native_entry_name = "__pcl_main";
+
+// Optimizes the module for the host CPU and writes it as a relocatable object file.
+void emit_object(llvm::Module &m, unsigned opt_level, const std::filesystem::path &output);
+
+// Same as emit_object, then links the object with the runtime library into an executable. The
+// optimized module is split into `partitions` parts that are compiled to objects concurrently, 0
+// takes partition_count, see partition.hpp.
+void emit_executable(
+    llvm::Module &m, unsigned opt_level, const std::filesystem::path &output,
+    unsigned partitions = 0
+);
+
+} // namespace paracl::llvm_codegen
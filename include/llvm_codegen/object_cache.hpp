@@ -0,0 +1,62 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace paracl::llvm_codegen {
+
+// Object files of compiled modules kept in a directory between runs. A file is named after a hash
+// of the module IR, the target and the LLVM version. When the directory outgrows the size limit the
+// least recently used files are removed. Called from the compile threads of the JIT.
+class object_cache final : public llvm::ObjectCache {
+public:
+  static constexpr std::uintmax_t default_size_limit = 64 << 20; // In bytes
+
+private:
+  std::filesystem::path m_dir;
+  std::uintmax_t m_size_limit;
+  std::string m_target;
+
+  std::mutex m_mutex;
+  std::unordered_map<const llvm::Module *, std::string> m_pending; // Keys of modules being compiled
+  std::atomic<std::size_t> m_hits = 0, m_misses = 0;
+
+private:
+  auto key(const llvm::Module &m) const -> std::string;
+  auto path(const std::string &key) const { return m_dir / (key + ".o"); }
+  void evict();
+
+public:
+  object_cache(std::filesystem::path dir, std::uintmax_t size_limit = default_size_limit);
+
+  // Description of the code generator (CPU, features, level) that becomes part of the keys.
+  void set_target(std::string target) { m_target = std::move(target); }
+
+  auto getObject(const llvm::Module *m) -> std::unique_ptr<llvm::MemoryBuffer> override;
+  void notifyObjectCompiled(const llvm::Module *m, llvm::MemoryBufferRef obj) override;
+
+  std::size_t hits() const { return m_hits; }
+  std::size_t misses() const { return m_misses; }
+};
+
+} // namespace paracl::llvm_codegen
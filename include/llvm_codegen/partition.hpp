@@ -0,0 +1,33 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/Module.h>
+
+#include <vector>
+
+namespace paracl::llvm_codegen {
+
+constexpr unsigned functions_per_partition = 32;
+constexpr unsigned max_partitions = 16;
+
+// Number of modules an optimized module is split into for code generation. It depends only on the
+// number of defined functions, not on the machine, so the same program gives the same objects.
+unsigned partition_count(const llvm::Module &m);
+
+// Splits the functions of an optimized module into at most `count` modules. Every part gets an
+// LLVMContext of its own so that the parts can be compiled concurrently. Functions and globals that
+// are internal to `m` and used across the parts become hidden externals, which is safe for the
+// names with symbol_prefix. The assignment to parts only depends on the names. Parts without definitions are dropped, `m` is left unusable.
+std::vector<llvm::orc::ThreadSafeModule> split_module(llvm::Module &m, unsigned count);
+
+} // namespace paracl::llvm_codegen
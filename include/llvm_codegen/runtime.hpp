@@ -0,0 +1,43 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "utils/memo_table.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Functions called by the code of the LLVM backend. Linked into pclc for the JIT and into the
+// executables built with --emit-exe.
+extern "C" {
+// Every module owns its output buffer and prints by appending to it, see get_print_function. Main
+// hands the buffer over first, so that the runtime can flush it before reads and on errors.
+void __attach_output(char *data, int32_t *size);
+void __flush_output();
+
+int32_t __read();
+
+// Called by checked subscripts with an index outside of the array, doesn't return.
+[[noreturn]] void __bounds_error(int32_t index, int32_t size);
+
+// Lookup returns 1 and writes the cached value to `result` on a hit.
+int32_t __memo_lookup(int32_t id, const int32_t *args, int32_t n_args, int32_t *result);
+void __memo_store(int32_t id, const int32_t *args, int32_t n_args, int32_t value);
+}
+
+namespace paracl::llvm_codegen::runtime {
+
+constexpr std::size_t output_buffer_size = 1 << 16;
+constexpr std::size_t max_print_length = 12; // Sign, 10 digits and the newline
+
+const utils::memo_table<int32_t> &memo();
+
+} // namespace paracl::llvm_codegen::runtime
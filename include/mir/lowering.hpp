@@ -0,0 +1,25 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/analysis/function_table.hpp"
+#include "frontend/ast/ast_container.hpp"
+
+#include "mir/mir.hpp"
+
+namespace paracl::mir {
+
+// Translates a semantically correct AST to the mid-level IR. Local variables are put into SSA form
+// during the translation (Braun et al., "Simple and Efficient Construction of Static Single
+// Assignment Form"). Variables of main that are used by functions become globals.
+module lower(const frontend::ast::ast_container &ast, const frontend::functions_analytics &functions);
+
+} // namespace paracl::mir
@@ -0,0 +1,174 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "frontend/ast/ast_nodes/binary_expression.hpp"
+#include "frontend/ast/ast_nodes/unary_expression.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Mid-level IR of ParaCL. A program is a module of functions, a function is a control flow graph
+// of basic blocks and every instruction defines at most one SSA value. Values and blocks are
+// numbered when the module is dumped. Local variables only exist
+// as SSA values, memory is used for globals that functions share with main and for arrays.
+namespace paracl::mir {
+
+enum class opcode {
+  E_CONST,         // Integer constant in `imm`
+  E_PARAM,         // Function parameter number `imm`
+  E_PHI,           // One operand per predecessor of the block, in the same order
+  E_BINARY,        // operands[0] `bin_op` operands[1]
+  E_UNARY,         // `un_op` operands[0], unary plus is never emitted
+  E_READ,          // `?`
+  E_PRINT,         // print operands[0]
+  E_LOAD_GLOBAL,   // Value of the global `symbol`
+  E_STORE_GLOBAL,  // Writes operands[0] to the global `symbol`
+  E_ARRAY,         // New zero-filled array of `imm` elements
+  E_LOAD_ELEMENT,  // operands[0][operands[1]]
+  E_STORE_ELEMENT, // operands[0][operands[1]] = operands[2]
+  E_FUNCTION,      // Address of the function `symbol`
+  E_CALL,          // Call of the function `symbol` with the operands as arguments
+  E_CALL_INDIRECT, // Call through the function pointer operands[0]
+  E_JUMP,          // Jump to targets[0]
+  E_BRANCH,        // Jump to targets[0] if operands[0] is not zero and to targets[1] otherwise
+  E_RETURN,        // Return from the function with an optional operand
+};
+
+class basic_block;
+
+class instruction final {
+public:
+  opcode op;
+  int imm = 0;
+  bool has_value; // Stores, prints, terminators and calls of void functions define nothing
+  std::string symbol;
+  frontend::ast::binary_operation bin_op = frontend::ast::binary_operation::E_BIN_OP_ADD;
+  frontend::ast::unary_operation un_op = frontend::ast::unary_operation::E_UN_OP_NEG;
+  std::vector<instruction *> operands;
+  std::vector<basic_block *> targets;
+  basic_block *parent = nullptr;
+
+public:
+  instruction(opcode p_op, basic_block &p_parent) : op{p_op}, parent{&p_parent} {
+    has_value = !is_terminator() && op != opcode::E_PRINT && op != opcode::E_STORE_GLOBAL &&
+                op != opcode::E_STORE_ELEMENT;
+  }
+
+  bool is_terminator() const {
+    return op == opcode::E_JUMP || op == opcode::E_BRANCH || op == opcode::E_RETURN;
+  }
+
+  // Can be removed when nobody uses the value.
+  bool is_removable() const {
+    using frontend::ast::binary_operation;
+    switch (op) {
+    case opcode::E_CONST:
+    case opcode::E_PHI:
+    case opcode::E_UNARY:
+    case opcode::E_LOAD_GLOBAL:
+    case opcode::E_ARRAY:
+    case opcode::E_LOAD_ELEMENT: // Arrays aren't bounds checked
+    case opcode::E_FUNCTION: return true;
+    case opcode::E_BINARY: // Division by zero traps
+      return bin_op != binary_operation::E_BIN_OP_DIV && bin_op != binary_operation::E_BIN_OP_MOD;
+    default: return false;
+    }
+  }
+};
+
+class basic_block final {
+public:
+  using instruction_list = std::list<std::unique_ptr<instruction>>;
+
+public:
+  instruction_list instructions; // Phis come first, the terminator is the last one
+  std::vector<basic_block *> predecessors;
+
+public:
+  bool terminated() const { return !instructions.empty() && instructions.back()->is_terminator(); }
+
+  std::vector<basic_block *> successors() const {
+    if (!terminated()) return {};
+    return instructions.back()->targets;
+  }
+
+  instruction &append(opcode op) {
+    assert(!terminated() && "Appending to a finished basic block");
+    return *instructions.emplace_back(std::make_unique<instruction>(op, *this));
+  }
+
+  instruction &prepend(opcode op) {
+    return *instructions.emplace_front(std::make_unique<instruction>(op, *this));
+  }
+
+  // Drops an incoming edge and the matching operands of the phis.
+  void remove_predecessor(std::size_t index) {
+    assert(index < predecessors.size());
+    predecessors.erase(predecessors.begin() + index);
+    for (auto &inst : instructions) {
+      if (inst->op != opcode::E_PHI) break;
+      inst->operands.erase(inst->operands.begin() + index);
+    }
+  }
+};
+
+class function final {
+public:
+  std::string name;
+  unsigned n_params = 0;
+  bool returns_value = false;
+  std::vector<std::unique_ptr<basic_block>> blocks; // The first one is the entry block
+
+public:
+  function(std::string p_name, unsigned params, bool value)
+      : name{std::move(p_name)}, n_params{params}, returns_value{value} {}
+
+  basic_block &entry() {
+    assert(!blocks.empty());
+    return *blocks.front();
+  }
+
+  basic_block &create_block() {
+    return *blocks.emplace_back(std::make_unique<basic_block>());
+  }
+
+  // Makes every instruction that uses `from` use `to` instead.
+  void replace_uses(const instruction *from, instruction *to) {
+    for (auto &block : blocks) {
+      for (auto &inst : block->instructions) {
+        auto is_from = [from](const instruction *op) { return op == from; };
+        std::replace_if(inst->operands.begin(), inst->operands.end(), is_from, to);
+      }
+    }
+  }
+};
+
+class module final {
+public:
+  std::vector<std::string> globals;
+  std::vector<std::unique_ptr<function>> functions; // The first one is main
+
+public:
+  function &create_function(std::string name, unsigned n_params, bool returns_value) {
+    return *functions.emplace_back(std::make_unique<function>(std::move(name), n_params, returns_value));
+  }
+};
+
+void dump(const module &mod, std::ostream &os);
+
+} // namespace paracl::mir
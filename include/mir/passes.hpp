@@ -0,0 +1,40 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include "mir/mir.hpp"
+
+namespace paracl::mir {
+
+// Every pass returns the number of changes it made.
+
+// Removes the blocks that can't be reached from the entry together with their phi operands.
+unsigned remove_unreachable_blocks(function &func);
+
+// Evaluates arithmetic on constants. Division and modulo by zero are left to trap at runtime.
+unsigned fold_constants(function &func);
+
+// Turns branches on a constant into jumps.
+unsigned fold_branches(function &func);
+
+// Glues a block to its only predecessor when that predecessor just jumps to it.
+unsigned merge_blocks(function &func);
+
+// Replaces phis whose operands are all the same value (or the phi itself) with that value.
+unsigned remove_trivial_phis(function &func);
+
+// Removes instructions without side effects whose values are never used.
+unsigned remove_dead_values(function &func);
+
+// Runs the passes above until nothing changes.
+void optimize(module &mod);
+
+} // namespace paracl::mir
@@ -0,0 +1,53 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace utils {
+
+// Result cache for memoized pure functions. Every function gets its own unbounded table keyed by the
+// argument values. Shared by the bytecode VM and the runtime of the LLVM backend.
+template <typename T> class memo_table {
+  using key_type = std::vector<T>;
+  std::vector<std::map<key_type, T>> m_tables;
+
+  std::size_t m_hits = 0, m_misses = 0;
+
+private:
+  auto &table(unsigned id) {
+    if (id >= m_tables.size()) m_tables.resize(id + 1);
+    return m_tables[id];
+  }
+
+public:
+  std::optional<T> lookup(unsigned id, std::span<const T> args) {
+    auto &tab = table(id);
+    auto found = tab.find(key_type{args.begin(), args.end()});
+    if (found == tab.end()) {
+      ++m_misses;
+      return std::nullopt;
+    }
+    ++m_hits;
+    return found->second;
+  }
+
+  void store(unsigned id, key_type args, T value) { table(id).insert_or_assign(std::move(args), value); }
+
+  std::size_t hits() const { return m_hits; }
+  std::size_t misses() const { return m_misses; }
+};
+
+} // namespace utils
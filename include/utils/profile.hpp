@@ -0,0 +1,105 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long
+ * as you retain this notice you can do whatever you want with this stuff. If we
+ * meet some day, and you think this stuff is worth it, you can buy us a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+struct source_position {
+  int line = 0;
+  int column = 0;
+
+  auto operator<=>(const source_position &) const = default;
+};
+
+// Execution counts of a program keyed by source position. Written by the bytecode VM and used by
+// the LLVM backend to optimize for the same inputs. Statements that the frontend copies, e.g.
+// unrolled loops or inlined bodies, share the position and so the counts.
+//
+// The file has one record per line:
+//   branch <line>:<column> <true count> <false count> -- condition of an `if` or a `while`
+//   function <line>:<column> <count>                 -- calls of a function definition
+class execution_profile {
+public:
+  struct branch_counts {
+    std::uint64_t true_count = 0, false_count = 0;
+  };
+
+private:
+  std::map<source_position, branch_counts> m_branches;
+  std::map<source_position, std::uint64_t> m_functions;
+
+  static constexpr std::string_view header = "# paracl profile 1";
+
+public:
+  void add_branch(source_position pos, std::uint64_t true_count, std::uint64_t false_count) {
+    auto &counts = m_branches[pos];
+    counts.true_count += true_count;
+    counts.false_count += false_count;
+  }
+
+  void add_function(source_position pos, std::uint64_t count) { m_functions[pos] += count; }
+
+  std::optional<branch_counts> branch(source_position pos) const {
+    auto found = m_branches.find(pos);
+    if (found == m_branches.end()) return std::nullopt;
+    return found->second;
+  }
+
+  std::optional<std::uint64_t> function(source_position pos) const {
+    auto found = m_functions.find(pos);
+    if (found == m_functions.end()) return std::nullopt;
+    return found->second;
+  }
+
+  const auto &branches() const { return m_branches; }
+  const auto &functions() const { return m_functions; }
+
+  void write(std::ostream &os) const {
+    os << header << "\n";
+    for (auto &&[pos, counts] : m_branches) {
+      os << "branch " << pos.line << ":" << pos.column << " " << counts.true_count << " "
+         << counts.false_count << "\n";
+    }
+    for (auto &&[pos, count] : m_functions) {
+      os << "function " << pos.line << ":" << pos.column << " " << count << "\n";
+    }
+  }
+
+  static std::optional<execution_profile> read(std::istream &is) {
+    std::string line;
+    if (!std::getline(is, line) || line != header) return std::nullopt;
+
+    execution_profile profile;
+    for (std::string kind; is >> kind;) {
+      source_position pos;
+      char colon = 0;
+      if (!(is >> pos.line >> colon >> pos.column) || colon != ':') return std::nullopt;
+
+      std::uint64_t first = 0, second = 0;
+      if (kind == "branch" && is >> first >> second) profile.add_branch(pos, first, second);
+      else if (kind == "function" && is >> first) profile.add_function(pos, first);
+      else return std::nullopt;
+    }
+
+    return profile;
+  }
+};
+
+} // namespace utils
@@ -15,6 +15,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace utils::transparent {
 
@@ -27,9 +28,12 @@ struct string_equal {
 
 struct string_hash {
   using is_transparent = string_equal;
-  bool operator()(const convertible_to_string_view auto &val) const { return std::hash<std::string_view>{}(val); }
+  std::size_t operator()(const convertible_to_string_view auto &val) const {
+    return std::hash<std::string_view>{}(val);
+  }
 };
 
 template <typename T> using string_unordered_map = std::unordered_map<std::string, T, string_hash, string_equal>;
+using string_unordered_set = std::unordered_set<std::string, string_hash, string_equal>;
 
 } // namespace utils::transparent
\ No newline at end of file
@@ -0,0 +1,29 @@
+#!/bin/sh
+
+file=$2 # Program that is run twice through the JIT with the same object cache
+input=/dev/null
+[ -f "${file}.in" ] && input=${file}.in
+
+cache_dir=$(mktemp -d /tmp/paracl-cache.XXXXXX)
+ansfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+errfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+passed=0
+
+for run in cold warm; do
+  echo -n "Testing ${green}${file}${reset} with a ${run} cache ... "
+  $1 -t llvm --cache-dir $cache_dir --cache-stats $file < $input > $ansfile 2> $errfile
+
+  # The second run has to load every object from the cache
+  diff -Z ${file}.ans $ansfile && { [ $run = cold ] || grep -q "Object cache: [1-9][0-9]* hits, 0 misses" $errfile; }
+
+  if [ $? -eq 0 ]; then
+    echo "${green}Passed${reset}"
+  else
+    echo "${red}Failed${reset}"
+    cat $errfile
+    passed=1
+  fi
+done
+
+rm -rf $cache_dir
+exit $passed
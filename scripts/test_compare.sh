@@ -1,39 +1,42 @@
 #!/bin/sh
 
 current_folder=${2:-./}
+runner=$3 # Empty when the compiler writes executables
+compile_flags=$4 # Extra options for the compiler, e.g. optimizations to test
+output_flags=$5  # Extra options when writing the binary
 passed=0
 
 ansfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+errfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
 binfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
 
-for file in $current_folder/*.pcl; do
-  echo -n "Testing ${green}${file}${reset} ... "
-  if [ -f "${file}.in" ]; then
-    $1 $file < ${file}.in > $ansfile
-  else 
-    $1 $file > $ansfile
+# Programs with a .err file have to fail with exit code 1 and that message after the output
+check_output() {
+  if [ -f "${file}.err" ]; then
+    [ $1 -eq 1 ] && diff -Z ${file}.ans $ansfile && diff -Z ${file}.err $errfile
+  else
+    diff -Z ${file}.ans $ansfile || { cat $errfile; false; }
   fi
 
-  if diff -Z ${file}.ans $ansfile; then
+  if [ $? -eq 0 ]; then
     echo "${green}Passed${reset}"
   else
     echo "${red}Failed${reset}"
     passed=1
   fi
+}
 
-  $1 $file -o$binfile
-  if [ -f "${file}.in" ]; then
-    $3 $binfile < ${file}.in > $ansfile
-  else 
-    $3 $binfile > $ansfile
-  fi
+for file in $current_folder/*.pcl; do
+  input=/dev/null
+  [ -f "${file}.in" ] && input=${file}.in
 
-  if diff -Z ${file}.ans $ansfile; then
-    echo "${green}Passed${reset}"
-  else
-    echo "${red}Failed${reset}"
-    passed=1
-  fi
+  echo -n "Testing ${green}${file}${reset} ... "
+  $1 $compile_flags $file < $input > $ansfile 2> $errfile
+  check_output $?
+
+  $1 $compile_flags $output_flags $file -o$binfile
+  $runner $binfile < $input > $ansfile 2> $errfile
+  check_output $?
 done
 
-exit $passed
\ No newline at end of file
+exit $passed
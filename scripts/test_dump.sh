@@ -0,0 +1,19 @@
+#!/bin/sh
+
+current_folder=${2:-./}
+dump_flags=$3 # Options that make the compiler print a representation of the program and exit
+passed=0
+
+for file in $current_folder/*.pcl; do
+  echo -n "Testing ${green}${file}${reset} ... "
+  $1 $dump_flags $file | diff -Z ${file}.ans -
+
+  if [ $? -eq 0 ]; then
+    echo "${green}Passed${reset}"
+  else
+    echo "${red}Failed${reset}"
+    passed=1
+  fi
+done
+
+exit $passed
@@ -0,0 +1,22 @@
+#!/bin/sh
+
+file=$3 # Program that is profiled by the VM ($2) and compiled with the profile by $1
+input=/dev/null
+[ -f "${file}.in" ] && input=${file}.in
+
+binfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+profile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+ansfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+errfile=$(mktemp /tmp/paracl-temp.tmp.XXXXXX)
+
+echo -n "Testing ${green}${file}${reset} with its profile ... "
+$1 $file -o $binfile && $2 $binfile --write-profile $profile < $input > /dev/null &&
+  $1 -t llvm --use-profile $profile --emit-llvm $file < $input > $ansfile 2> $errfile
+
+# Same output as without the profile, and the counts made it into the IR as branch weights
+if [ $? -eq 0 ] && diff -Z ${file}.ans $ansfile && grep -q '!prof' $errfile; then
+  echo "${green}Passed${reset}"
+else
+  echo "${red}Failed${reset}"
+  exit 1
+fi
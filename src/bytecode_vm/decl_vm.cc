@@ -12,6 +12,7 @@ namespace paracl::bytecode_vm::decl_vm {
 
 constexpr unsigned magic_bytes_length = 6;
 constexpr std::array<char, magic_bytes_length> header = {0xB, 0x0, 0x0, 0xB, 0xE, 0xC};
+constexpr unsigned profile_point_size = sizeof(unsigned) * 4;
 
 std::optional<chunk> read_chunk(std::istream &is) {
   auto raw_bytes = read_raw_data(is);
@@ -37,8 +38,10 @@ std::optional<chunk> read_chunk(std::istream &is) {
     return std::nullopt;
   }
 
-  if (raw_bytes.size() !=
-      magic_bytes_length + sizeof(unsigned) * 2 + count_constants.value() * sizeof(int) + length_binary.value()) {
+  // The code may be followed by the profile points, see write_chunk
+  const auto code_size =
+      magic_bytes_length + sizeof(unsigned) * 2 + count_constants.value() * sizeof(int) + length_binary.value();
+  if (raw_bytes.size() < code_size) {
     std::cerr << "File size does not match\n";
     return std::nullopt;
   }
@@ -53,9 +56,33 @@ std::optional<chunk> read_chunk(std::istream &is) {
 
   binary_code_buffer_type buf;
   buf.reserve(length_binary.value());
-  std::copy(first, last, std::back_inserter(buf));
+  std::copy_n(first, length_binary.value(), std::back_inserter(buf));
+  std::advance(first, length_binary.value());
 
-  return chunk{std::move(buf), std::move(pool)};
+  chunk ch{std::move(buf), std::move(pool)};
+  if (first == last) return ch;
+
+  auto [count_points, after_points_count_it] = utils::read_little_endian<unsigned>(first, last);
+  if (!count_points || std::distance(after_points_count_it, last) != count_points.value() * profile_point_size) {
+    std::cerr << "Invalid profile points\n";
+    return std::nullopt;
+  }
+
+  first = after_points_count_it;
+  profile_points_type points;
+  for (unsigned i = 0; i < count_points.value(); ++i) {
+    std::array<unsigned, 4> fields;
+    for (auto &field : fields) {
+      auto [value, iter] = utils::read_little_endian<unsigned>(first, last);
+      first = iter;
+      field = value.value();
+    }
+    auto kind = static_cast<profile_point::kind_type>(fields[1]);
+    points.push_back({fields[0], kind, static_cast<int>(fields[2]), static_cast<int>(fields[3])});
+  }
+
+  ch.set_profile_points(std::move(points));
+  return ch;
 }
 
 void write_chunk(std::ostream &os, const chunk &ch) {
@@ -81,6 +108,17 @@ void write_chunk(std::ostream &os, const chunk &ch) {
 
   os.write(reinterpret_cast<const char *>(raw_constants.data()), raw_constants.size());
   os.write(reinterpret_cast<const char *>(ch.binary_data()), ch.binary_size());
+
+  // Write profile points: count, then address, kind, line and column of each
+  std::vector<char> raw_points;
+  utils::write_little_endian<unsigned>(ch.profile_points().size(), std::back_inserter(raw_points));
+  for (auto &&point : ch.profile_points()) {
+    for (unsigned field : {point.address, unsigned(point.kind), unsigned(point.line), unsigned(point.column)}) {
+      utils::write_little_endian(field, std::back_inserter(raw_points));
+    }
+  }
+
+  os.write(reinterpret_cast<const char *>(raw_points.data()), raw_points.size());
 }
 
 } // namespace paracl::bytecode_vm::decl_vm
\ No newline at end of file
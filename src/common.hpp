@@ -17,10 +17,13 @@
 #include "bytecode_vm/virtual_machine.hpp"
 
 #include "utils/files.hpp"
+#include "utils/profile.hpp"
 
 #include <fmt/core.h>
 #include <fmt/format.h>
 
+#include <cstddef>
+#include <fstream>
 #include <memory>
 #include <optional>
 #include <string>
@@ -41,10 +44,40 @@ constexpr int k_exit_failure = 1;
   disas(std::cout, ch);
 }
 
-[[maybe_unused]] void execute_chunk(const decl_vm::chunk &ch) {
+[[maybe_unused]] void print_memo_stats(std::size_t hits, std::size_t misses) {
+  fmt::println(stderr, "Memoization: {} hits, {} misses", hits, misses);
+}
+
+// A taken jump skips the body, so the condition was false.
+[[maybe_unused]] auto to_execution_profile(const decl_vm::chunk &ch, const auto &counts) {
+  utils::execution_profile profile;
+  const auto &points = ch.profile_points();
+  for (unsigned i = 0; i < points.size(); ++i) {
+    auto &&[address, kind, line, column] = points[i];
+    auto &&[executed, taken] = counts.at(i);
+    if (kind == decl_vm::profile_point::E_BRANCH) {
+      profile.add_branch({line, column}, executed - taken, taken);
+    } else {
+      profile.add_function({line, column}, executed);
+    }
+  }
+  return profile;
+}
+
+// Runs the program, the execution profile is written to `profile_file` if it isn't empty.
+[[maybe_unused]] void execute_chunk(
+    const decl_vm::chunk &ch, bool memo_stats = false, const std::string &profile_file = {}
+) {
   auto vm = bytecode_vm::create_paracl_vm();
-  vm.set_program_code(std::move(ch));
-  vm.execute();
+  vm.set_program_code(ch);
+  if (profile_file.empty()) vm.execute();
+  else vm.execute_profiled();
+  if (memo_stats) print_memo_stats(vm.memo().hits(), vm.memo().misses());
+  if (profile_file.empty()) return;
+
+  std::ofstream output;
+  utils::try_open_file(output, profile_file, std::ios::out);
+  to_execution_profile(ch, vm.profile_counts()).write(output);
 }
 
 } // namespace
@@ -0,0 +1,863 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/bounds_check_eliminator.hpp"
+
+#include "frontend/analysis/assignment_collector.hpp"
+#include "frontend/analysis/loop_body.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+#include "frontend/ast/typed_ast_copier.hpp"
+#include "frontend/types/types.hpp"
+
+#include "utils/misc.hpp"
+#include "utils/transparent.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+using ast::binary_operation;
+using ast::unary_operation;
+
+constexpr std::int64_t min_int = std::numeric_limits<int>::min();
+constexpr std::int64_t max_int = std::numeric_limits<int>::max();
+
+// Range of values of an integer expression. The default one means that nothing is known.
+struct interval {
+  std::int64_t lo = min_int;
+  std::int64_t hi = max_int;
+
+  // Arithmetic wraps around, so a result that doesn't fit into an int can be anything.
+  static interval make(std::int64_t lo, std::int64_t hi) {
+    if (lo < min_int || hi > max_int) return {};
+    return {lo, hi};
+  }
+
+  bool empty() const { return lo > hi; }
+  bool unknown() const { return lo == min_int && hi == max_int; }
+  bool contains(const interval &rhs) const { return lo <= rhs.lo && rhs.hi <= hi; }
+};
+
+interval join(const interval &lhs, const interval &rhs) {
+  return {std::min(lhs.lo, rhs.lo), std::max(lhs.hi, rhs.hi)};
+}
+
+interval meet(const interval &lhs, const interval &rhs) {
+  return {std::max(lhs.lo, rhs.lo), std::min(lhs.hi, rhs.hi)};
+}
+
+// Bounds that keep growing are moved to the limits, so that loops reach a fixpoint quickly.
+interval widen(const interval &old, const interval &next) {
+  return {next.lo < old.lo ? min_int : old.lo, next.hi > old.hi ? max_int : old.hi};
+}
+
+interval evaluate(binary_operation op, const interval &lhs, const interval &rhs) {
+  // Bounds are 64-bit, so negating an INT_MIN divisor below doesn't overflow
+  std::optional<std::int64_t> constant = std::nullopt;
+  if (rhs.lo == rhs.hi) constant = rhs.lo;
+
+  switch (op) {
+  case binary_operation::E_BIN_OP_ADD: return interval::make(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+  case binary_operation::E_BIN_OP_SUB: return interval::make(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+
+  case binary_operation::E_BIN_OP_MUL: {
+    const std::int64_t products[] = {
+        lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo, lhs.hi * rhs.hi};
+    return interval::make(*std::ranges::min_element(products), *std::ranges::max_element(products));
+  }
+
+  case binary_operation::E_BIN_OP_DIV: {
+    if (!constant || *constant == 0) return {};
+    return interval::make(
+        std::min(lhs.lo / *constant, lhs.hi / *constant),
+        std::max(lhs.lo / *constant, lhs.hi / *constant)
+    );
+  }
+
+  case binary_operation::E_BIN_OP_MOD: {
+    if (!constant || *constant == 0) return {};
+    const std::int64_t largest = (*constant < 0 ? -*constant : *constant) - 1;
+    if (lhs.lo >= 0) return {0, std::min(lhs.hi, largest)};
+    if (lhs.hi <= 0) return {std::max(lhs.lo, -largest), 0};
+    return {-largest, largest};
+  }
+
+  default: return {0, 1};
+  }
+}
+
+// Comparison that holds when the one given is false.
+binary_operation negate(binary_operation op) {
+  switch (op) {
+  case binary_operation::E_BIN_OP_EQ: return binary_operation::E_BIN_OP_NE;
+  case binary_operation::E_BIN_OP_NE: return binary_operation::E_BIN_OP_EQ;
+  case binary_operation::E_BIN_OP_GT: return binary_operation::E_BIN_OP_LE;
+  case binary_operation::E_BIN_OP_LS: return binary_operation::E_BIN_OP_GE;
+  case binary_operation::E_BIN_OP_GE: return binary_operation::E_BIN_OP_LS;
+  case binary_operation::E_BIN_OP_LE: return binary_operation::E_BIN_OP_GT;
+  default: return op;
+  }
+}
+
+bool is_comparison(binary_operation op) { return negate(op) != op; }
+
+const ast::variable_expression *as_variable(const ast::i_expression &ref) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_VARIABLE_EXPRESSION) return nullptr;
+  auto &var = static_cast<const ast::variable_expression &>(ref);
+  return (var.type == types::type_builtin::type_int ? &var : nullptr);
+}
+
+std::optional<int> as_constant(const ast::i_expression &ref) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_CONSTANT_EXPRESSION) return std::nullopt;
+  return static_cast<const ast::constant_expression &>(ref).value();
+}
+
+bool is_variable(const ast::i_expression &ref, std::string_view name) {
+  auto *var = as_variable(ref);
+  return var && var->name() == name;
+}
+
+// Expressions made of integer variables, constants and operators. They have no side effects, so
+// conditions like that can be used to refine the state right after they are evaluated.
+bool is_simple(const ast::i_expression &ref) {
+  switch (ast::identify_node(ref)) {
+  case ast::ast_node_type::E_CONSTANT_EXPRESSION: return true;
+  case ast::ast_node_type::E_VARIABLE_EXPRESSION: return as_variable(ref) != nullptr;
+  case ast::ast_node_type::E_BINARY_EXPRESSION: {
+    auto &binary = static_cast<const ast::binary_expression &>(ref);
+    return is_simple(binary.left()) && is_simple(binary.right());
+  }
+  case ast::ast_node_type::E_UNARY_EXPRESSION:
+    return is_simple(static_cast<const ast::unary_expression &>(ref).expr());
+  default: return false;
+  }
+}
+
+// Ranges of the integer variables at some point of a program.
+class range_state final {
+  utils::transparent::string_unordered_map<interval> m_ranges; // Missing ones are unknown
+  bool m_reachable = true;
+
+private:
+  // A variable that is unknown on either side stays unknown.
+  template <typename t_merge> void merge(const range_state &rhs, t_merge merge_ranges) {
+    if (!rhs.m_reachable) return;
+    if (!m_reachable) {
+      *this = rhs;
+      return;
+    }
+
+    for (auto start = m_ranges.begin(); start != m_ranges.end();) {
+      auto found = rhs.m_ranges.find(start->first);
+      if (found != rhs.m_ranges.end()) start->second = merge_ranges(start->second, found->second);
+      if (found == rhs.m_ranges.end() || start->second.unknown()) start = m_ranges.erase(start);
+      else ++start;
+    }
+  }
+
+public:
+  static range_state unreachable() {
+    range_state state;
+    state.m_reachable = false;
+    return state;
+  }
+
+  bool reachable() const { return m_reachable; }
+
+  interval get(std::string_view name) const {
+    auto found = m_ranges.find(name);
+    return (found == m_ranges.end() ? interval{} : found->second);
+  }
+
+  void set(std::string_view name, const interval &range) {
+    if (range.empty()) {
+      *this = unreachable();
+      return;
+    }
+
+    if (!range.unknown()) {
+      m_ranges.insert_or_assign(std::string{name}, range);
+      return;
+    }
+
+    forget(name);
+  }
+
+  void forget(std::string_view name) {
+    auto found = m_ranges.find(name);
+    if (found != m_ranges.end()) m_ranges.erase(found);
+  }
+
+  void forget_all() { m_ranges.clear(); }
+
+  void join(const range_state &rhs) { merge(rhs, frontend::join); }
+  void widen(const range_state &next) { merge(next, frontend::widen); }
+
+  // Tells if every state described by rhs is also described by this one.
+  bool includes(const range_state &rhs) const {
+    if (!rhs.m_reachable) return true;
+    if (!m_reachable) return false;
+    return std::ranges::all_of(m_ranges, [&rhs](auto &entry) {
+      return entry.second.contains(rhs.get(entry.first));
+    });
+  }
+};
+
+// What is known about the index of a subscript over all of the times it's evaluated.
+struct subscript_range {
+  interval index;
+  std::optional<std::size_t> size; // Unknown when the array can't be resolved
+};
+
+using subscript_ranges = std::unordered_map<ast::subscript *, subscript_range>;
+
+// Abstract interpretation of a function body or main with intervals. Every visit returns the range
+// of the visited expression.
+class range_analyzer final : public ezvis::visitor_base<ast::i_ast_node, range_analyzer, interval> {
+public:
+  static constexpr unsigned widening_delay = 2; // Loop iterations before the bounds are widened
+
+private:
+  // Where the returns of the innermost value block go.
+  struct block_exit {
+    range_state state = range_state::unreachable();
+    std::optional<interval> value;
+  };
+
+  const functions_analytics &m_functions;
+  subscript_ranges &m_subscripts;
+  range_state m_state;
+  std::vector<const symtab *> m_scopes;
+  block_exit *m_exit = nullptr;
+
+private:
+  bool is_pure(const ast::function_definition &def) const {
+    if (!def.name) return false;
+    auto found = m_functions.named_functions.lookup(def.name.value());
+    return found && found->pure;
+  }
+
+  std::optional<std::size_t> array_size(std::string_view name) const {
+    for (auto start = m_scopes.rbegin(), finish = m_scopes.rend(); start != finish; ++start) {
+      auto attr = (*start)->get_attributes(name);
+      if (!attr) continue;
+
+      auto *def = attr->m_definition;
+      if (!def || !def->type || def->type.base().get_class() != types::type_class::E_ARRAY) {
+        return std::nullopt;
+      }
+      return static_cast<const types::type_array &>(def->type.base()).size;
+    }
+    return std::nullopt;
+  }
+
+  void check(ast::subscript &ref) {
+    const auto index = apply(*ref.get_subscript());
+    if (!m_state.reachable()) return;
+
+    const auto size = array_size(ref.name());
+    auto [found, inserted] = m_subscripts.try_emplace(&ref, subscript_range{index, size});
+    if (inserted) return;
+
+    auto &range = found->second;
+    range.index = join(range.index, index);
+    if (range.size != size) range.size = std::nullopt;
+  }
+
+  template <typename t_block> void analyze_block(t_block &ref) {
+    m_scopes.push_back(&ref.stab);
+    for (auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      if (!m_state.reachable()) break;
+      apply(*st);
+    }
+
+    // Names of the block are declared anew when it's entered again.
+    for (const auto &[name, attr] : ref.stab) {
+      m_state.forget(name);
+    }
+    m_scopes.pop_back();
+  }
+
+  void refine_comparison(binary_operation op, ast::i_expression &lhs, ast::i_expression &rhs) {
+    if (op == binary_operation::E_BIN_OP_GT || op == binary_operation::E_BIN_OP_GE) {
+      refine_comparison(
+          op == binary_operation::E_BIN_OP_GT ? binary_operation::E_BIN_OP_LS
+                                              : binary_operation::E_BIN_OP_LE,
+          rhs, lhs
+      );
+      return;
+    }
+
+    auto left = apply(lhs);
+    auto right = apply(rhs);
+
+    switch (op) {
+    case binary_operation::E_BIN_OP_LS:
+      left = meet(left, {min_int, right.hi - 1});
+      right = meet(right, {left.lo + 1, max_int});
+      break;
+    case binary_operation::E_BIN_OP_LE:
+      left = meet(left, {min_int, right.hi});
+      right = meet(right, {left.lo, max_int});
+      break;
+    case binary_operation::E_BIN_OP_EQ: left = right = meet(left, right); break;
+    case binary_operation::E_BIN_OP_NE: {
+      auto exclude = [](interval range, const interval &value) {
+        if (value.lo != value.hi) return range;
+        if (range.lo == value.lo) ++range.lo;
+        if (range.hi == value.hi) --range.hi;
+        return range;
+      };
+      const auto old_left = left;
+      left = exclude(left, right);
+      right = exclude(right, old_left);
+      break;
+    }
+    default: return;
+    }
+
+    if (left.empty() || right.empty()) {
+      m_state = range_state::unreachable();
+      return;
+    }
+
+    if (auto *var = as_variable(lhs)) m_state.set(var->name(), left);
+    if (auto *var = as_variable(rhs)) m_state.set(var->name(), right);
+  }
+
+  void refine_simple(ast::i_expression &cond, bool truth) {
+    if (!m_state.reachable()) return;
+
+    if (auto value = as_constant(cond)) {
+      if ((*value != 0) != truth) m_state = range_state::unreachable();
+      return;
+    }
+
+    if (auto *var = as_variable(cond)) {
+      auto range = m_state.get(var->name());
+      if (!truth) range = meet(range, {0, 0});
+      else if (range.lo == 0) ++range.lo;
+      else if (range.hi == 0) --range.hi;
+      m_state.set(var->name(), range);
+      return;
+    }
+
+    if (ast::identify_node(cond) == ast::ast_node_type::E_UNARY_EXPRESSION) {
+      auto &unary = static_cast<ast::unary_expression &>(cond);
+      if (unary.op_type() == unary_operation::E_UN_OP_NOT) refine_simple(unary.expr(), !truth);
+      return;
+    }
+
+    if (ast::identify_node(cond) != ast::ast_node_type::E_BINARY_EXPRESSION) return;
+    auto &binary = static_cast<ast::binary_expression &>(cond);
+    const auto op = binary.op_type();
+
+    if (is_comparison(op)) {
+      refine_comparison(truth ? op : negate(op), binary.left(), binary.right());
+      return;
+    }
+
+    // `a && b` is false when a is false or when a is true and b is false, the same goes for ||.
+    const bool conjunction = (op == binary_operation::E_BIN_OP_AND);
+    if (!conjunction && op != binary_operation::E_BIN_OP_OR) return;
+
+    if (truth == conjunction) {
+      refine_simple(binary.left(), truth);
+      refine_simple(binary.right(), truth);
+      return;
+    }
+
+    auto other = m_state;
+    refine_simple(binary.left(), truth);
+    std::swap(m_state, other);
+    refine_simple(binary.left(), !truth);
+    refine_simple(binary.right(), truth);
+    m_state.join(other);
+  }
+
+  void refine(ast::i_expression &cond, bool truth) {
+    if (is_simple(cond)) refine_simple(cond, truth);
+  }
+
+public:
+  range_analyzer(const functions_analytics &functions, subscript_ranges &subscripts)
+      : m_functions{functions}, m_subscripts{subscripts} {
+    if (functions.global_stab) m_scopes.push_back(functions.global_stab);
+  }
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  interval analyze(ast::statement_block &ref) {
+    analyze_block(ref);
+    return {};
+  }
+
+  interval analyze(ast::value_block &ref) {
+    block_exit exit;
+    auto *outer = std::exchange(m_exit, &exit);
+    analyze_block(ref);
+    m_exit = outer;
+
+    // Falling off the end of a value block gives 0.
+    if (m_state.reachable()) {
+      exit.state.join(m_state);
+      exit.value = join(exit.value.value_or(interval{0, 0}), {0, 0});
+    }
+
+    m_state = std::move(exit.state);
+    return exit.value.value_or(interval{});
+  }
+
+  interval analyze(ast::return_statement &ref) {
+    const auto value = (ref.empty() ? interval{} : apply(ref.expr()));
+    if (m_exit) {
+      m_exit->state.join(m_state);
+      m_exit->value = (m_exit->value ? join(*m_exit->value, value) : value);
+    }
+
+    m_state = range_state::unreachable();
+    return {};
+  }
+
+  interval analyze(ast::if_statement &ref) {
+    apply(*ref.cond());
+    auto otherwise = m_state;
+
+    refine(*ref.cond(), true);
+    apply(*ref.true_block());
+
+    std::swap(m_state, otherwise);
+    refine(*ref.cond(), false);
+    if (ref.else_block()) apply(*ref.else_block());
+
+    m_state.join(otherwise);
+    return {};
+  }
+
+  interval analyze(ast::while_statement &ref) {
+    const auto entry = m_state;
+    auto head = m_state;
+
+    for (unsigned iteration = 0;; ++iteration) {
+      m_state = head;
+      apply(*ref.cond());
+      auto exit = m_state;
+
+      refine(*ref.cond(), true);
+      apply(*ref.block());
+      m_state.join(entry);
+
+      if (head.includes(m_state)) {
+        m_state = std::move(exit);
+        refine(*ref.cond(), false);
+        return {};
+      }
+
+      if (iteration < widening_delay) head.join(m_state);
+      else head.widen(m_state);
+    }
+  }
+
+  interval analyze(ast::constant_expression &ref) { return {ref.value(), ref.value()}; }
+
+  interval analyze(ast::variable_expression &ref) {
+    return (ref.type == types::type_builtin::type_int ? m_state.get(ref.name()) : interval{});
+  }
+
+  interval analyze(ast::subscript &ref) {
+    check(ref);
+    return {};
+  }
+
+  interval analyze(ast::binary_expression &ref) {
+    const auto lhs = apply(ref.left());
+
+    // The right side of && and || might be skipped.
+    const auto op = ref.op_type();
+    if (op == binary_operation::E_BIN_OP_AND || op == binary_operation::E_BIN_OP_OR) {
+      auto skipped = m_state;
+      apply(ref.right());
+      m_state.join(skipped);
+      return {0, 1};
+    }
+
+    const auto rhs = apply(ref.right());
+    return evaluate(op, lhs, rhs);
+  }
+
+  interval analyze(ast::unary_expression &ref) {
+    const auto value = apply(ref.expr());
+    switch (ref.op_type()) {
+    case unary_operation::E_UN_OP_NEG: return interval::make(-value.hi, -value.lo);
+    case unary_operation::E_UN_OP_POS: return value;
+    default: return {0, 1};
+    }
+  }
+
+  // Variables are stored in the order of the codegen, so subscripts see the ones stored before.
+  interval analyze(ast::assignment_statement &ref) {
+    const auto value = apply(ref.right());
+    for (auto &left : std::views::reverse(ref)) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) {
+        check(*sub);
+        continue;
+      }
+
+      auto &var = std::get<ast::variable_expression>(left);
+      if (var.type == types::type_builtin::type_int) m_state.set(var.name(), value);
+      else m_state.forget(var.name());
+    }
+    return value;
+  }
+
+  interval analyze(ast::print_statement &ref) {
+    apply(ref.expr());
+    return {};
+  }
+
+  interval analyze(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+
+    // A function defined inside of a block can assign its variables, not only the globals.
+    if (!ref.m_def || !is_pure(*ref.m_def)) m_state.forget_all();
+    return {};
+  }
+
+  // Function bodies are analyzed separately, see analyze_function.
+  interval analyze(ast::i_ast_node &) { return {}; }
+
+  EZVIS_VISIT_INVOKER(analyze);
+
+  void analyze_function(ast::function_definition &def) {
+    m_scopes.push_back(&def.param_stab);
+    apply(def.body());
+    m_scopes.pop_back();
+  }
+};
+
+// Subscripts of a subtree in a fixed order and its size in AST nodes. Copies made by the
+// typed_ast_copier have their subscripts in the same order.
+class subscript_collector final
+    : public ezvis::visitor_base<ast::i_ast_node, subscript_collector, void> {
+public:
+  std::vector<ast::subscript *> subscripts;
+  unsigned size = 0;
+
+private:
+  template <typename t_block> void collect_block(t_block &ref) {
+    for (auto *st : ref) {
+      assert(st);
+      count(*st);
+    }
+  }
+
+  void count(ast::i_ast_node &ref) {
+    ++size;
+    apply(ref);
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(ast::statement_block &ref) { collect_block(ref); }
+  void collect(ast::value_block &ref) { collect_block(ref); }
+
+  void collect(ast::if_statement &ref) {
+    count(*ref.cond());
+    count(*ref.true_block());
+    if (ref.else_block()) count(*ref.else_block());
+  }
+
+  void collect(ast::while_statement &ref) {
+    count(*ref.cond());
+    count(*ref.block());
+  }
+
+  void collect(ast::subscript &ref) {
+    subscripts.push_back(&ref);
+    count(*ref.get_subscript());
+  }
+
+  void collect(ast::assignment_statement &ref) {
+    for (auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) collect(*sub);
+    }
+    count(ref.right());
+  }
+
+  void collect(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      count(*arg);
+    }
+  }
+
+  void collect(ast::binary_expression &ref) {
+    count(ref.left());
+    count(ref.right());
+  }
+
+  void collect(ast::print_statement &ref) { count(ref.expr()); }
+  void collect(ast::unary_expression &ref) { count(ref.expr()); }
+
+  void collect(ast::return_statement &ref) {
+    if (!ref.empty()) count(ref.expr());
+  }
+
+  void collect(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+};
+
+// Recognizes `i`, `i + c`, `c + i` and `i - c`. Returns c.
+std::optional<std::int64_t> offset_of(const ast::i_expression &ref, std::string_view name) {
+  if (is_variable(ref, name)) return 0;
+  if (ast::identify_node(ref) != ast::ast_node_type::E_BINARY_EXPRESSION) return std::nullopt;
+  auto &binary = static_cast<const ast::binary_expression &>(ref);
+
+  switch (binary.op_type()) {
+  case binary_operation::E_BIN_OP_ADD:
+    if (is_variable(binary.left(), name)) return as_constant(binary.right());
+    if (is_variable(binary.right(), name)) return as_constant(binary.left());
+    return std::nullopt;
+  case binary_operation::E_BIN_OP_SUB: {
+    if (!is_variable(binary.left(), name)) return std::nullopt;
+    auto value = as_constant(binary.right());
+    if (!value) return std::nullopt;
+    return -std::int64_t{*value};
+  }
+  default: return std::nullopt;
+  }
+}
+
+// Hoists the checks of counting loops: `while (i < n) body` becomes
+// `if (n <= limit) while (i < n) checked-less body; else while (i < n) body`.
+class loop_versioner final : public ezvis::visitor_base<ast::i_ast_node, loop_versioner, void> {
+  ast::ast_container &m_ast;
+  const functions_analytics &m_functions;
+  const subscript_ranges &m_subscripts;
+
+public:
+  unsigned removed = 0;
+
+private:
+  ast::statement_block &wrap(ast::i_ast_node &ref) {
+    auto &block = m_ast.make_node<ast::statement_block>();
+    block.append_statement(ref);
+    return block;
+  }
+
+  // Returns the statement that replaces the loop.
+  ast::i_ast_node *version(ast::while_statement &loop) {
+    auto &cond = *loop.cond();
+    if (ast::identify_node(cond) != ast::ast_node_type::E_BINARY_EXPRESSION) return nullptr;
+    auto &compare = static_cast<const ast::binary_expression &>(cond);
+
+    const auto op = compare.op_type();
+    if (op != binary_operation::E_BIN_OP_LS && op != binary_operation::E_BIN_OP_LE) return nullptr;
+
+    auto *index = as_variable(compare.left());
+    auto *bound = as_variable(compare.right());
+    if (!index || !bound || index->name() == bound->name()) return nullptr;
+
+    // Until the last statement of the body the index is below the bound, which doesn't change.
+    auto &body = loop_body(loop);
+    if (!body.size()) return nullptr;
+
+    assignment_collector collector = {m_functions};
+    subscript_collector candidates;
+    for (auto start = body.begin(), finish = std::prev(body.end()); start != finish; ++start) {
+      collector.apply(**start);
+      candidates.apply(**start);
+    }
+
+    auto assigned = collector.take_assigned();
+    if (assigned.contains(index->name()) || assigned.contains(bound->name())) return nullptr;
+    if (assignment_collector{m_functions}.collect_all(*body.back()).contains(bound->name())) {
+      return nullptr;
+    }
+
+    const std::int64_t strict = (op == binary_operation::E_BIN_OP_LS ? 0 : 1);
+    std::vector<ast::subscript *> unchecked;
+    std::int64_t limit = max_int;
+
+    for (auto *sub : candidates.subscripts) {
+      if (sub->m_in_bounds) continue;
+      auto found = m_subscripts.find(sub);
+      if (found == m_subscripts.end()) continue;
+
+      const auto &range = found->second;
+      if (!range.size || range.index.lo < 0) continue;
+
+      auto offset = offset_of(*sub->get_subscript(), index->name());
+      if (!offset) continue;
+
+      // index + offset < size holds for every index < bound when bound <= size - offset.
+      const auto size = static_cast<std::int64_t>(std::min<std::size_t>(*range.size, max_int));
+      limit = std::min(limit, size - *offset - strict);
+      unchecked.push_back(sub);
+    }
+
+    if (unchecked.empty() || limit < min_int) return nullptr;
+
+    if (limit == max_int) {
+      for (auto *sub : unchecked) {
+        sub->m_in_bounds = true;
+      }
+      removed += unchecked.size();
+      return nullptr;
+    }
+
+    subscript_collector original;
+    original.apply(loop);
+    if (original.size > bounds_check_eliminator::max_versioned_size) return nullptr;
+
+    const ast::typed_ast_copier::rename_map names;
+    ast::typed_ast_copier copier = {m_ast, names};
+    auto &fast = copier.copy(loop);
+
+    subscript_collector copies;
+    copies.apply(fast);
+    assert(copies.subscripts.size() == original.subscripts.size());
+
+    for (auto *sub : unchecked) {
+      auto position = std::ranges::find(original.subscripts, sub) - original.subscripts.begin();
+      copies.subscripts[position]->m_in_bounds = true;
+    }
+    removed += unchecked.size();
+
+    const auto loc = loop.loc();
+    auto &fits = m_ast.make_node<ast::binary_expression>(
+        binary_operation::E_BIN_OP_LE,
+        m_ast.make_node<ast::variable_expression>(
+            std::string{bound->name()}, types::type_builtin::type_int, loc
+        ),
+        m_ast.make_node<ast::constant_expression>(static_cast<int>(limit), loc), loc
+    );
+    fits.type = types::type_builtin::type_int;
+
+    return &m_ast.make_node<ast::if_statement>(fits, wrap(fast), wrap(loop), loc);
+  }
+
+  template <typename t_block> void version_in_block(t_block &ref) {
+    for (auto &st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      apply(*st); // Inner loops go first
+
+      // clang-format off
+      auto *loop = ezvis::visit<ast::while_statement *, ast::while_statement, ast::i_ast_node>(
+          ::utils::visitors{
+              [](ast::while_statement &w) { return &w; },
+              [](ast::i_ast_node &) -> ast::while_statement * { return nullptr; }},
+          *st
+      ); // clang-format on
+      if (!loop) continue;
+
+      if (auto *replacement = version(*loop)) st = replacement;
+    }
+  }
+
+public:
+  loop_versioner(
+      ast::ast_container &ast, const functions_analytics &functions,
+      const subscript_ranges &subscripts
+  )
+      : m_ast{ast}, m_functions{functions}, m_subscripts{subscripts} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void version_node(ast::statement_block &ref) { version_in_block(ref); }
+  void version_node(ast::value_block &ref) { version_in_block(ref); }
+
+  void version_node(ast::if_statement &ref) {
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void version_node(ast::while_statement &ref) { apply(*ref.block()); }
+
+  void version_node(ast::assignment_statement &ref) { apply(ref.right()); }
+  void version_node(ast::print_statement &ref) { apply(ref.expr()); }
+  void version_node(ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void version_node(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void version_node(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void version_node(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void version_node(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(version_node);
+};
+
+} // namespace
+
+unsigned
+bounds_check_eliminator::eliminate(ast::ast_container &ast, const functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  subscript_ranges subscripts;
+  range_analyzer{functions, subscripts}.apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    range_analyzer{functions, subscripts}.analyze_function(*attr.definition);
+  }
+
+  unsigned removed = 0;
+  for (auto &&[sub, range] : subscripts) {
+    if (!range.size || range.index.lo < 0) continue;
+    if (static_cast<std::uint64_t>(range.index.hi) >= *range.size) continue;
+    sub->m_in_bounds = true;
+    ++removed;
+  }
+
+  loop_versioner versioner = {ast, functions, subscripts};
+  versioner.apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    versioner.apply(attr.definition->body());
+  }
+
+  return removed + versioner.removed;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,275 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/common_subexpression_eliminator.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+bool is_pure_call(const ast::function_call &ref, const functions_analytics &functions) {
+  if (!ref.m_def || !ref.m_def->name) return false;
+  auto found = functions.named_functions.lookup(ref.m_def->name.value());
+  return found && found->pure;
+}
+
+// Builds the structural key of an expression. Fails for expressions that don't always produce the
+// same value for the same variables.
+class value_hasher final : public ezvis::visitor_base<const ast::i_ast_node, value_hasher, bool> {
+  const functions_analytics &m_functions;
+
+public:
+  std::string key;
+  std::vector<std::string> variables;
+
+public:
+  value_hasher(const functions_analytics &functions) : m_functions{functions} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  bool hash(const ast::constant_expression &ref) {
+    key += std::to_string(ref.value());
+    return true;
+  }
+
+  bool hash(const ast::variable_expression &ref) {
+    key += ref.name();
+    variables.emplace_back(ref.name());
+    return true;
+  }
+
+  bool hash(const ast::binary_expression &ref) {
+    key += fmt::format("({} ", ast::binary_operation_to_string(ref.op_type()));
+    if (!apply(ref.left())) return false;
+    key += ' ';
+    if (!apply(ref.right())) return false;
+    key += ')';
+    return true;
+  }
+
+  bool hash(const ast::unary_expression &ref) {
+    key += fmt::format("(unary{} ", ast::unary_operation_to_string(ref.op_type()));
+    if (!apply(ref.expr())) return false;
+    key += ')';
+    return true;
+  }
+
+  bool hash(const ast::subscript &ref) {
+    key += fmt::format("{}[", ref.name());
+    variables.emplace_back(ref.name());
+    if (!apply(*ref.get_subscript())) return false;
+    key += ']';
+    return true;
+  }
+
+  bool hash(const ast::function_call &ref) {
+    if (!is_pure_call(ref, m_functions)) return false;
+    key += fmt::format("{}(", ref.m_def->name.value());
+    for (const auto *arg : ref) {
+      assert(arg);
+      if (!apply(*arg)) return false;
+      key += ' ';
+    }
+    key += ')';
+    return true;
+  }
+
+  bool hash(const ast::i_ast_node &) { return false; }
+
+  EZVIS_VISIT_INVOKER(hash);
+};
+
+// Only computations are worth a temporary.
+bool is_candidate(const ast::i_expression &ref) {
+  using ast::ast_node_type;
+  switch (ast::identify_node(ref)) {
+  case ast_node_type::E_BINARY_EXPRESSION:
+  case ast_node_type::E_SUBSCRIPT:
+  case ast_node_type::E_FUNCTION_CALL: return true;
+  case ast_node_type::E_UNARY_EXPRESSION: {
+    auto &unary = static_cast<const ast::unary_expression &>(ref);
+    return ast::identify_node(unary.expr()) != ast_node_type::E_CONSTANT_EXPRESSION;
+  }
+  default: return false;
+  }
+}
+
+} // namespace
+
+template <typename t_block> void common_subexpression_eliminator::eliminate_in_block(t_block &ref) {
+  auto *old_stab = std::exchange(m_stab, &ref.stab);
+  auto old_numbers = std::exchange(m_numbers, {});
+
+  for (auto &st : ref) {
+    assert(st && "Broken statement pointer in a block");
+    const auto node_type = ast::identify_node(*st);
+    const bool is_expression =
+        std::find(ast::ast_expression_types.begin(), ast::ast_expression_types.end(), node_type) !=
+        ast::ast_expression_types.end();
+
+    if (is_expression && node_type != ast::ast_node_type::E_ASSIGNMENT_STATEMENT) {
+      process_expr(static_cast<ast::i_expression &>(*st), [&st](auto &expr) { st = &expr; });
+      continue;
+    }
+
+    apply(*st);
+  }
+
+  m_stab = old_stab;
+  m_numbers = std::move(old_numbers);
+}
+
+void common_subexpression_eliminator::process_expr(
+    ast::i_expression &ref, const replace_function &replace
+) {
+  value_hasher hasher = {*m_functions};
+
+  if (is_candidate(ref) && hasher.apply(ref)) {
+    auto found = m_numbers.find(hasher.key);
+    if (found == m_numbers.end()) {
+      // Children can't change the value, so the entry stays valid while they are processed.
+      m_numbers.emplace(
+          std::move(hasher.key), value_number{&ref, replace, {}, std::move(hasher.variables)}
+      );
+    }
+
+    else {
+      auto &number = found->second;
+      if (number.temporary.empty()) {
+        auto &first = *number.first;
+        number.temporary = fmt::format("$cse-{}", m_temporaries++);
+
+        auto &def = m_ast->make_node<ast::variable_expression>(
+            number.temporary, first.type, first.loc()
+        );
+        auto &init = m_ast->make_node<ast::assignment_statement>(def, first, first.loc());
+        init.type = first.type;
+
+        m_stab->declare(number.temporary, &def);
+        number.replace_first(init);
+      }
+
+      replace(m_ast->make_node<ast::variable_expression>(number.temporary, ref.type, ref.loc()));
+      ++m_eliminated;
+      return;
+    }
+  }
+
+  process_children(ref);
+}
+
+void common_subexpression_eliminator::process_children(ast::i_expression &ref) {
+  using ast::ast_node_type;
+  switch (ast::identify_node(ref)) {
+  case ast_node_type::E_BINARY_EXPRESSION: {
+    auto &binary = static_cast<ast::binary_expression &>(ref);
+    process_expr(binary.left(), [&binary](auto &expr) { binary.set_left(expr); });
+    process_expr(binary.right(), [&binary](auto &expr) { binary.set_right(expr); });
+    break;
+  }
+
+  case ast_node_type::E_UNARY_EXPRESSION: {
+    auto &unary = static_cast<ast::unary_expression &>(ref);
+    process_expr(unary.expr(), [&unary](auto &expr) { unary.set_expr(expr); });
+    break;
+  }
+
+  case ast_node_type::E_SUBSCRIPT: {
+    auto &sub = static_cast<ast::subscript &>(ref);
+    process_expr(*sub.get_subscript(), [&sub](auto &expr) { sub.set_subscript(expr); });
+    break;
+  }
+
+  case ast_node_type::E_FUNCTION_CALL: {
+    auto &call = static_cast<ast::function_call &>(ref);
+    for (std::size_t i = 0; i < call.size(); ++i) {
+      process_expr(**std::next(call.begin(), i), [&call, i](auto &expr) {
+        call.set_parameter(i, expr);
+      });
+    }
+    if (!is_pure_call(call, *m_functions)) m_numbers.clear(); // Could change any global
+    break;
+  }
+
+  case ast_node_type::E_ASSIGNMENT_STATEMENT: apply(ref); break;
+
+  case ast_node_type::E_VALUE_BLOCK:
+    apply(ref);
+    m_numbers.clear();
+    break;
+
+  case ast_node_type::E_READ_EXPRESSION: m_numbers.clear(); break;
+
+  default: break;
+  }
+}
+
+void common_subexpression_eliminator::forget(std::string_view variable) {
+  std::erase_if(m_numbers, [variable](auto &&number) {
+    auto &&variables = number.second.variables;
+    return std::find(variables.begin(), variables.end(), variable) != variables.end();
+  });
+}
+
+void common_subexpression_eliminator::eliminate_node(ast::if_statement &ref) {
+  process_expr(*ref.cond(), [&ref](auto &expr) { ref.set_cond(expr); });
+  apply(*ref.true_block());
+  if (ref.else_block()) apply(*ref.else_block());
+  m_numbers.clear();
+}
+
+void common_subexpression_eliminator::eliminate_node(ast::while_statement &ref) {
+  // The condition and the body run many times, nothing computed before the loop stays valid.
+  m_numbers.clear();
+  apply(*ref.block());
+  m_numbers.clear();
+}
+
+void common_subexpression_eliminator::eliminate_node(ast::assignment_statement &ref) {
+  process_expr(ref.right(), [&ref](auto &expr) { ref.set_right(expr); });
+  for (const auto &left : ref) {
+    std::visit([this](auto &&var) { forget(var.name()); }, left);
+  }
+}
+
+unsigned common_subexpression_eliminator::eliminate_all(
+    ast::ast_container &ast, const functions_analytics &functions
+) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  m_ast = &ast;
+  m_functions = &functions;
+  m_eliminated = 0;
+
+  apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    apply(attr.definition->body());
+  }
+
+  return m_eliminated;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,297 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/dead_code_eliminator.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include "utils/misc.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+// Collects the names of all variables that are read somewhere in the program. Names are not
+// resolved to scopes, so a store is only considered dead when its name is not read anywhere.
+class read_collector final
+    : public ezvis::visitor_base<const ast::i_ast_node, read_collector, void> {
+  utils::transparent::string_unordered_set m_reads;
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(const ast::variable_expression &ref) { m_reads.emplace(ref.name()); }
+
+  void collect(const ast::subscript &ref) {
+    m_reads.emplace(ref.name());
+    apply(*ref.get_subscript());
+  }
+
+  void collect(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      if (std::holds_alternative<ast::subscript>(left)) collect(std::get<ast::subscript>(left));
+    }
+    apply(ref.right());
+  }
+
+  void collect(const ast::function_call &ref) {
+    m_reads.emplace(ref.name()); // Calls through function pointer variables
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void collect(const ast::statement_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  void collect(const ast::value_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  void collect(const ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void collect(const ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void collect(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void collect(const ast::print_statement &ref) { apply(ref.expr()); }
+  void collect(const ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void collect(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void collect(const ast::function_definition &ref) { apply(ref.body()); }
+  void collect(const ast::function_definition_to_ptr_conv &ref) { apply(ref.definition()); }
+
+  void collect(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+
+  utils::transparent::string_unordered_set collect_all(const ast::i_ast_node &root) {
+    m_reads.clear();
+    apply(root);
+    return std::move(m_reads);
+  }
+};
+
+// Tells if an expression can be evaluated and thrown away without changing the observable
+// behaviour. Division is kept because of the division by zero.
+class side_effect_detector final
+    : public ezvis::visitor_base<const ast::i_ast_node, side_effect_detector, bool> {
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  bool has_side_effects(const ast::constant_expression &) { return false; }
+  bool has_side_effects(const ast::variable_expression &) { return false; }
+  bool has_side_effects(const ast::function_definition_to_ptr_conv &) { return false; }
+  bool has_side_effects(const ast::unary_expression &ref) { return apply(ref.expr()); }
+
+  bool has_side_effects(const ast::binary_expression &ref) {
+    using ast::binary_operation;
+    if (ref.op_type() == binary_operation::E_BIN_OP_DIV ||
+        ref.op_type() == binary_operation::E_BIN_OP_MOD) {
+      return true;
+    }
+    return apply(ref.left()) || apply(ref.right());
+  }
+
+  bool has_side_effects(const ast::i_ast_node &) { return true; }
+
+  EZVIS_VISIT_INVOKER(has_side_effects);
+};
+
+// Walks the code reachable from main. Function definition statements don't make a function
+// reachable by themselves, only calls and conversions to function pointers do.
+class reachability_walker final
+    : public ezvis::visitor_base<const ast::i_ast_node, reachability_walker, void> {
+  std::unordered_set<const ast::function_definition *> m_reachable;
+  std::vector<const ast::function_definition *> m_worklist;
+
+private:
+  void reach(const ast::function_definition *def) {
+    if (def && m_reachable.insert(def).second) m_worklist.push_back(def);
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void walk(const ast::function_call &ref) {
+    reach(ref.m_def);
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void walk(const ast::function_definition_to_ptr_conv &ref) { reach(&ref.definition()); }
+
+  void walk(const ast::statement_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  void walk(const ast::value_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  void walk(const ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void walk(const ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void walk(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void walk(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      if (std::holds_alternative<ast::subscript>(left)) {
+        apply(*std::get<ast::subscript>(left).get_subscript());
+      }
+    }
+    apply(ref.right());
+  }
+
+  void walk(const ast::subscript &ref) { apply(*ref.get_subscript()); }
+  void walk(const ast::print_statement &ref) { apply(ref.expr()); }
+  void walk(const ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void walk(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void walk(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(walk);
+
+  std::unordered_set<const ast::function_definition *> walk_all(const ast::i_ast_node &root) {
+    m_reachable.clear();
+    apply(root);
+
+    while (!m_worklist.empty()) {
+      const auto *def = m_worklist.back();
+      m_worklist.pop_back();
+      apply(def->body());
+    }
+
+    return std::move(m_reachable);
+  }
+};
+
+} // namespace
+
+bool dead_code_eliminator::is_dead_store(const ast::assignment_statement &ref) const {
+  return std::all_of(ref.begin(), ref.end(), [this](auto &&left) {
+    return std::holds_alternative<ast::variable_expression>(left) &&
+           !m_reads.contains(std::get<ast::variable_expression>(left).name());
+  });
+}
+
+template <typename t_block> void dead_code_eliminator::eliminate_in_block(t_block &ref) {
+  auto is_return = [](const ast::i_ast_node *st) {
+    return ast::identify_node(st) == ast::ast_node_type::E_RETURN_STATEMENT;
+  };
+
+  if (auto found = std::find_if(ref.begin(), ref.end(), is_return); found != ref.end()) {
+    if (std::next(found) != ref.end()) {
+      ref.erase(std::next(found), ref.end());
+      m_changed = true;
+    }
+  }
+
+  for (auto start = ref.begin(); start != ref.end();) {
+    assert(*start && "Broken statement pointer in a block");
+    using assignment_ptr = ast::assignment_statement *;
+    // clang-format off
+    auto *assignment = ezvis::visit<assignment_ptr, ast::assignment_statement, ast::i_ast_node>(
+        ::utils::visitors{
+            [](ast::assignment_statement &a) { return &a; },
+            [](ast::i_ast_node &) -> assignment_ptr { return nullptr; }},
+        **start
+    ); // clang-format on
+
+    if (assignment && is_dead_store(*assignment)) {
+      m_changed = true;
+      if (!side_effect_detector{}.apply(assignment->right())) {
+        start = ref.erase(start);
+        continue;
+      }
+      *start = &assignment->right(); // Keep the side effects of the right side.
+    }
+
+    apply(**start);
+    ++start;
+  }
+}
+
+unsigned dead_code_eliminator::eliminate(ast::ast_container &ast, functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  // Removing a store can make its right side's variables unused as well, so iterate to a fixpoint.
+  do {
+    m_changed = false;
+    m_reads = read_collector{}.collect_all(*root);
+    apply(*root);
+  } while (m_changed);
+
+  auto reachable = reachability_walker{}.walk_all(*root);
+
+  unsigned eliminated = 0;
+  for (auto &&[key, attr] : functions.usegraph) {
+    auto &&[name, func] = attr.value;
+    if (reachable.contains(func)) continue;
+    functions.named_functions.erase(name);
+    ++eliminated;
+  }
+
+  return eliminated;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,336 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/function_devirtualizer.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+#include "frontend/ast/typed_ast_copier.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+namespace paracl::frontend {
+
+namespace {
+
+using decl_ptr = const ast::variable_expression *;
+
+struct points_to_set {
+  std::unordered_set<ast::function_definition *> targets;
+  bool unknown = false; // Anything whose address was taken
+
+  bool merge(const points_to_set &rhs) {
+    const auto size = targets.size();
+    const bool was_unknown = unknown;
+    targets.insert(rhs.targets.begin(), rhs.targets.end());
+    unknown = unknown || rhs.unknown;
+    return targets.size() != size || unknown != was_unknown;
+  }
+
+  ast::function_definition *unique() const {
+    return (!unknown && targets.size() == 1 ? *targets.begin() : nullptr);
+  }
+};
+
+// What a function-typed expression can evaluate to: a known set or the value of a variable.
+struct source {
+  points_to_set functions;
+  decl_ptr variable = nullptr;
+};
+
+struct call_site {
+  ast::function_call *call;
+  decl_ptr callee; // The variable called through, nullptr for direct calls
+  std::vector<source> args;
+  ast::function_definition *caller; // nullptr in main
+};
+
+class constraint_collector final
+    : public ezvis::visitor_base<ast::i_ast_node, constraint_collector, void> {
+  const symtab &m_global_stab;
+  std::vector<const symtab *> m_scopes;
+  ast::function_definition *m_function = nullptr;
+
+public:
+  std::vector<std::pair<source, decl_ptr>> assignments;
+  std::vector<call_site> calls;
+  std::unordered_set<ast::function_definition *> address_taken;
+
+private:
+  decl_ptr resolve(std::string_view name) const {
+    for (auto start = m_scopes.rbegin(), finish = m_scopes.rend(); start != finish; ++start) {
+      if (auto attr = (*start)->get_attributes(name); attr) return attr->m_definition;
+    }
+
+    // Functions can only see the variables of main's global scope.
+    if (auto attr = m_global_stab.get_attributes(name); attr) return attr->m_definition;
+    return nullptr;
+  }
+
+  source source_of(const ast::i_expression &ref) const {
+    switch (ast::identify_node(ref)) {
+    case ast::ast_node_type::E_FUNCTION_DEFINITION_TO_PTR_CONV: {
+      auto &conv = static_cast<const ast::function_definition_to_ptr_conv &>(ref);
+      return {{{&conv.definition()}}};
+    }
+
+    case ast::ast_node_type::E_VARIABLE_EXPRESSION: {
+      auto *def = resolve(static_cast<const ast::variable_expression &>(ref).name());
+      if (def) return {{}, def};
+      break;
+    }
+
+    case ast::ast_node_type::E_ASSIGNMENT_STATEMENT:
+      return source_of(static_cast<const ast::assignment_statement &>(ref).right());
+
+    default: break;
+    }
+
+    return {{{}, true}}; // Returned from a call, read from an array and so on
+  }
+
+  template <typename t_block> void collect_block(t_block &ref) {
+    m_scopes.push_back(&ref.stab);
+    for (auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      apply(*st);
+    }
+    m_scopes.pop_back();
+  }
+
+public:
+  constraint_collector(const symtab &global_stab) : m_global_stab{global_stab} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(ast::statement_block &ref) { collect_block(ref); }
+  void collect(ast::value_block &ref) { collect_block(ref); }
+
+  void collect(ast::if_statement &ref) {
+    m_scopes.push_back(&ref.control_block_symtab);
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+    m_scopes.pop_back();
+  }
+
+  void collect(ast::while_statement &ref) {
+    m_scopes.push_back(&ref.symbol_table);
+    apply(*ref.cond());
+    apply(*ref.block());
+    m_scopes.pop_back();
+  }
+
+  void collect(ast::assignment_statement &ref) {
+    apply(ref.right());
+    const auto src = source_of(ref.right());
+
+    for (auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) {
+        apply(*sub->get_subscript());
+        continue;
+      }
+
+      auto *def = resolve(std::get<ast::variable_expression>(left).name());
+      if (def) assignments.emplace_back(src, def);
+    }
+  }
+
+  void collect(ast::function_call &ref) {
+    call_site site = {&ref, nullptr, {}, m_function};
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+      site.args.push_back(source_of(*arg));
+    }
+
+    if (!ref.m_def) site.callee = resolve(ref.name());
+    calls.push_back(std::move(site));
+  }
+
+  void collect(ast::function_definition_to_ptr_conv &ref) {
+    address_taken.insert(&ref.definition());
+  }
+
+  void collect(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void collect(ast::subscript &ref) { apply(*ref.get_subscript()); }
+  void collect(ast::print_statement &ref) { apply(ref.expr()); }
+  void collect(ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void collect(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void collect(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+
+  void collect_function(ast::function_definition &def) {
+    m_function = &def;
+    m_scopes = {&def.param_stab};
+    apply(def.body());
+    m_function = nullptr;
+    m_scopes.clear();
+  }
+};
+
+class points_to_solver final {
+  std::unordered_map<decl_ptr, points_to_set> m_sets;
+
+private:
+  bool flow(const source &src, decl_ptr to) {
+    if (!src.variable) return m_sets[to].merge(src.functions);
+    if (src.variable == to) return false;
+    const auto from = m_sets[src.variable]; // Inserting into the map invalidates references
+    return m_sets[to].merge(from);
+  }
+
+  bool bind_arguments(const call_site &site, const ast::function_definition &def) {
+    if (def.size() != site.args.size()) return false;
+    bool changed = false;
+    auto arg = site.args.begin();
+    for (const auto &param : def) {
+      changed = flow(*arg++, &param) || changed;
+    }
+    return changed;
+  }
+
+public:
+  void solve(const constraint_collector &constraints) {
+    const auto anything = source{{{}, true}};
+
+    for (bool changed = true; changed;) {
+      changed = false;
+
+      for (const auto &[src, to] : constraints.assignments) {
+        changed = flow(src, to) || changed;
+      }
+
+      for (const auto &site : constraints.calls) {
+        if (site.call->m_def) {
+          changed = bind_arguments(site, *site.call->m_def) || changed;
+          continue;
+        }
+
+        const auto targets = (site.callee ? get(site.callee) : anything.functions);
+        for (auto *def : targets.targets) {
+          changed = bind_arguments(site, *def) || changed;
+        }
+
+        if (!targets.unknown) continue;
+
+        // The call can reach any function whose address was taken, with any arguments.
+        for (auto *def : constraints.address_taken) {
+          for (const auto &param : *def) {
+            changed = flow(anything, &param) || changed;
+          }
+        }
+      }
+    }
+  }
+
+  const points_to_set &get(decl_ptr decl) { return m_sets[decl]; }
+
+  ast::function_definition *value_of(const source &src) {
+    return (src.variable ? get(src.variable).unique() : src.functions.unique());
+  }
+};
+
+} // namespace
+
+ast::function_definition &function_devirtualizer::clone(
+    ast::ast_container &ast, functions_analytics &functions, const specialization &key,
+    ast::function_definition *caller
+) {
+  auto found = m_clones.find(key);
+  if (found != m_clones.end()) return *found->second;
+
+  const auto &def = *key.first;
+  const auto name = fmt::format("$clone-{}-{}", m_clones.size(), def.name.value());
+
+  auto &copy = ast::clone_function(def, name, ast);
+  auto attr = functions.named_functions.lookup(def.name.value());
+  functions.add_function(copy, caller, attr && attr->recursive);
+
+  m_clones.emplace(key, &copy);
+  return copy;
+}
+
+unsigned
+function_devirtualizer::devirtualize(ast::ast_container &ast, functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root || !functions.global_stab) return 0;
+
+  unsigned devirtualized = 0;
+  for (unsigned round = 0; round < max_rounds; ++round) {
+    constraint_collector constraints = {*functions.global_stab};
+    constraints.apply(*root);
+    for (auto &&[name, attr] : functions.named_functions) {
+      assert(attr.definition);
+      constraints.collect_function(*attr.definition);
+    }
+
+    points_to_solver solver;
+    solver.solve(constraints);
+
+    // Variables that are still called through, specializing on them is worth it.
+    std::unordered_set<decl_ptr> called;
+    for (auto &site : constraints.calls) {
+      if (!site.callee) continue;
+      if (auto *target = solver.get(site.callee).unique()) {
+        site.call->m_def = target;
+        ++devirtualized;
+        continue;
+      }
+      called.insert(site.callee);
+    }
+
+    bool redirected = false;
+    for (auto &site : constraints.calls) {
+      auto *callee = site.call->m_def;
+      if (!callee || callee->size() != site.args.size()) continue;
+
+      specialization key = {callee, {}};
+      auto arg = site.args.begin();
+      for (const auto &param : *callee) {
+        auto *known = solver.value_of(*arg++);
+        const bool useful = known && called.contains(&param) && !solver.get(&param).unique();
+        key.second.push_back(useful ? known : nullptr);
+      }
+
+      const auto is_known = [](auto *def) { return def != nullptr; };
+      if (std::none_of(key.second.begin(), key.second.end(), is_known)) continue;
+      if (!m_clones.contains(key) && m_clones.size() >= max_clones) continue;
+
+      site.call->m_def = &clone(ast, functions, key, site.caller);
+      redirected = true;
+    }
+
+    if (!redirected) break;
+  }
+
+  return devirtualized;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,231 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/function_inliner.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+#include "frontend/ast/typed_ast_copier.hpp"
+
+#include "utils/misc.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace paracl::frontend {
+
+namespace {
+
+// Gathers what the inliner needs to know about a function body: its size, the names it uses and
+// declares, and whether it contains anything that prevents inlining.
+class function_summary final
+    : public ezvis::visitor_base<const ast::i_ast_node, function_summary, void> {
+public:
+  unsigned size = 0;
+  unsigned returns = 0;
+  bool inlinable = true; // No calls, nested definitions or errors inside
+  utils::transparent::string_unordered_set used, declared;
+
+private:
+  void declare(const symtab &stab) {
+    for (const auto &[name, attr] : stab) {
+      declared.emplace(name);
+    }
+  }
+
+  template <typename t_block> void summarize_block(const t_block &ref) {
+    declare(ref.stab);
+    for (const auto *st : ref) {
+      assert(st);
+      count(*st);
+    }
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void summarize(const ast::statement_block &ref) { summarize_block(ref); }
+  void summarize(const ast::value_block &ref) { summarize_block(ref); }
+
+  void summarize(const ast::if_statement &ref) {
+    declare(ref.control_block_symtab);
+    count(*ref.cond());
+    count(*ref.true_block());
+    if (ref.else_block()) count(*ref.else_block());
+  }
+
+  void summarize(const ast::while_statement &ref) {
+    declare(ref.symbol_table);
+    count(*ref.cond());
+    count(*ref.block());
+  }
+
+  void summarize(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      std::visit([this](auto &&var) { count(var); }, left);
+    }
+    count(ref.right());
+  }
+
+  void summarize(const ast::binary_expression &ref) {
+    count(ref.left());
+    count(ref.right());
+  }
+
+  void summarize(const ast::variable_expression &ref) { used.emplace(ref.name()); }
+
+  void summarize(const ast::subscript &ref) {
+    used.emplace(ref.name());
+    count(*ref.get_subscript());
+  }
+
+  void summarize(const ast::print_statement &ref) { count(ref.expr()); }
+  void summarize(const ast::unary_expression &ref) { count(ref.expr()); }
+
+  void summarize(const ast::return_statement &ref) {
+    ++returns;
+    if (!ref.empty()) count(ref.expr());
+  }
+
+  void summarize(const ast::constant_expression &) {}
+  void summarize(const ast::read_expression &) {}
+  void summarize(const ast::i_ast_node &) { inlinable = false; }
+
+  EZVIS_VISIT_INVOKER(summarize);
+
+  void count(const ast::i_ast_node &ref) {
+    ++size;
+    apply(ref);
+  }
+};
+
+} // namespace
+
+void function_inliner::find_candidates(const functions_analytics &functions) {
+  m_candidates.clear();
+
+  for (auto &&[key, attr] : functions.usegraph) {
+    auto &&[name, def] = attr.value;
+    auto found = functions.named_functions.lookup(name);
+    if (!found || found->recursive) continue;
+
+    assert(def);
+    auto *body = ezvis::visit<const ast::value_block *, ast::value_block, ast::i_ast_node>(
+        ::utils::visitors{
+            [](const ast::value_block &block) { return &block; },
+            [](const ast::i_ast_node &) -> const ast::value_block * { return nullptr; }},
+        std::as_const(def->body())
+    );
+    if (!body) continue;
+
+    function_summary summary;
+    summary.count(*body);
+    if (!summary.inlinable || summary.size > m_threshold) continue;
+
+    // A `return` in a void block would return from the enclosing function.
+    if (body->type == types::type_builtin::type_void && summary.returns) continue;
+
+    // Functions that touch globals or variables of the enclosing scopes are left alone, otherwise
+    // the names could resolve to something else at the call site.
+    for (const auto &param : *def) {
+      summary.declared.emplace(param.name());
+    }
+
+    bool closed = std::all_of(summary.used.begin(), summary.used.end(), [&summary](auto &&name) {
+      return summary.declared.contains(name);
+    });
+
+    if (closed) m_candidates.emplace(def, candidate{std::move(summary.declared)});
+  }
+}
+
+ast::i_expression &function_inliner::inline_expr(ast::i_expression &ref) {
+  apply(ref);
+
+  if (ast::identify_node(ref) != ast::ast_node_type::E_FUNCTION_CALL) return ref;
+  auto &call = static_cast<ast::function_call &>(ref);
+
+  if (!call.m_def || !m_candidates.contains(call.m_def)) return ref;
+  return inline_call(call, *call.m_def);
+}
+
+ast::value_block &
+function_inliner::inline_call(const ast::function_call &call, const ast::function_definition &def) {
+  const auto &locals = m_candidates.at(&def).locals;
+
+  utils::transparent::string_unordered_map<std::string> names;
+  for (const auto &name : locals) {
+    names.emplace(name, fmt::format("$inl-{}-{}", m_inlined, name));
+  }
+
+  ++m_inlined;
+
+  ast::typed_ast_copier copier = {*m_ast, names};
+  auto &body = static_cast<ast::value_block &>(copier.apply(def.body()));
+  auto &block = m_ast->make_node<ast::value_block>();
+
+  // Bind the arguments to the renamed parameters.
+  auto arg = call.begin();
+  for (const auto &param : def) {
+    assert(arg != call.end());
+    const auto &name = names.find(param.name())->second;
+    auto &init = m_ast->make_node<ast::assignment_statement>(
+        ast::variable_expression{name, param.type, call.loc()}, **arg, call.loc()
+    );
+    init.type = param.type;
+    block.append_statement(init);
+    block.stab.declare(name, def.param_stab.get_attributes(param.name())->m_definition);
+    ++arg;
+  }
+
+  for (auto *st : body) {
+    block.append_statement(*st);
+  }
+
+  for (const auto &[name, attr] : body.stab) {
+    block.stab.declare(name, attr.m_definition);
+  }
+
+  block.type = call.type;
+  return block;
+}
+
+unsigned
+function_inliner::inline_calls(ast::ast_container &ast, const functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  m_ast = &ast;
+  m_inlined = 0;
+
+  for (unsigned round = 0; round < max_rounds; ++round) {
+    find_candidates(functions);
+    if (m_candidates.empty()) break;
+
+    const auto inlined_before = m_inlined;
+    apply(*root);
+
+    for (auto &&[name, attr] : functions.named_functions) {
+      assert(attr.definition);
+      apply(attr.definition->body());
+    }
+
+    if (m_inlined == inlined_before) break;
+  }
+
+  return m_inlined;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,426 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/function_specializer.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+#include "frontend/ast/typed_ast_copier.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+using binding = std::vector<std::optional<int>>; // Constant of every parameter, if bound
+
+struct call_site {
+  ast::function_call *call;
+  ast::function_definition *caller; // nullptr in main
+  bool hot;                         // Inside of a loop
+};
+
+class call_collector final : public ezvis::visitor_base<ast::i_ast_node, call_collector, void> {
+  ast::function_definition *m_function = nullptr;
+  unsigned m_loop_depth = 0;
+
+public:
+  std::vector<call_site> calls;
+
+private:
+  template <typename t_block> void collect_block(t_block &ref) {
+    for (auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      apply(*st);
+    }
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(ast::statement_block &ref) { collect_block(ref); }
+  void collect(ast::value_block &ref) { collect_block(ref); }
+
+  void collect(ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void collect(ast::while_statement &ref) {
+    ++m_loop_depth;
+    apply(*ref.cond());
+    apply(*ref.block());
+    --m_loop_depth;
+  }
+
+  void collect(ast::assignment_statement &ref) {
+    for (auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) apply(*sub->get_subscript());
+    }
+    apply(ref.right());
+  }
+
+  void collect(ast::function_call &ref) {
+    for (auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+    calls.push_back({&ref, m_function, m_loop_depth > 0});
+  }
+
+  void collect(ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void collect(ast::subscript &ref) { apply(*ref.get_subscript()); }
+  void collect(ast::print_statement &ref) { apply(ref.expr()); }
+  void collect(ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void collect(ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  // Function bodies are handled separately, see collect_function.
+  void collect(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+
+  void collect_function(ast::function_definition &def) {
+    m_function = &def;
+    apply(def.body());
+    m_function = nullptr;
+  }
+};
+
+// Size of a function body and the names it assigns to.
+class body_summary final : public ezvis::visitor_base<const ast::i_ast_node, body_summary, void> {
+public:
+  unsigned size = 0;
+  utils::transparent::string_unordered_set assigned;
+
+private:
+  template <typename t_block> void summarize_block(const t_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      count(*st);
+    }
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void summarize(const ast::statement_block &ref) { summarize_block(ref); }
+  void summarize(const ast::value_block &ref) { summarize_block(ref); }
+
+  void summarize(const ast::if_statement &ref) {
+    count(*ref.cond());
+    count(*ref.true_block());
+    if (ref.else_block()) count(*ref.else_block());
+  }
+
+  void summarize(const ast::while_statement &ref) {
+    count(*ref.cond());
+    count(*ref.block());
+  }
+
+  void summarize(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) count(*sub->get_subscript());
+      else assigned.emplace(std::get<ast::variable_expression>(left).name());
+    }
+    count(ref.right());
+  }
+
+  void summarize(const ast::function_call &ref) {
+    for (const auto *arg : ref) {
+      assert(arg);
+      count(*arg);
+    }
+  }
+
+  void summarize(const ast::binary_expression &ref) {
+    count(ref.left());
+    count(ref.right());
+  }
+
+  void summarize(const ast::subscript &ref) { count(*ref.get_subscript()); }
+  void summarize(const ast::print_statement &ref) { count(ref.expr()); }
+  void summarize(const ast::unary_expression &ref) { count(ref.expr()); }
+
+  void summarize(const ast::return_statement &ref) {
+    if (!ref.empty()) count(ref.expr());
+  }
+
+  void summarize(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(summarize);
+
+  void count(const ast::i_ast_node &ref) {
+    ++size;
+    apply(ref);
+  }
+};
+
+std::optional<int> constant_value(const ast::i_expression &ref) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_CONSTANT_EXPRESSION) return std::nullopt;
+  return static_cast<const ast::constant_expression &>(ref).value();
+}
+
+// Replaces the bound parameters with constants and folds what becomes constant. Conditional
+// statements with a constant condition are replaced with the block that gets executed.
+class constant_binder final : public ezvis::visitor_base<ast::i_ast_node, constant_binder, void> {
+  ast::ast_container &m_ast;
+  const utils::transparent::string_unordered_map<int> &m_bound;
+
+private:
+  ast::i_expression &make_constant(int value, const ast::i_expression &ref) {
+    return m_ast.make_node<ast::constant_expression>(value, ref.loc());
+  }
+
+  ast::i_expression &fold(ast::i_expression &ref) {
+    apply(ref);
+
+    switch (ast::identify_node(ref)) {
+    case ast::ast_node_type::E_VARIABLE_EXPRESSION: {
+      auto found = m_bound.find(static_cast<ast::variable_expression &>(ref).name());
+      if (found != m_bound.end()) return make_constant(found->second, ref);
+      break;
+    }
+
+    case ast::ast_node_type::E_BINARY_EXPRESSION: {
+      auto &bin = static_cast<ast::binary_expression &>(ref);
+      auto left = constant_value(bin.left()), right = constant_value(bin.right());
+      if (!left || !right) break;
+      auto result = ast::evaluate_binary_operation(bin.op_type(), *left, *right);
+      if (result) return make_constant(*result, ref);
+      break;
+    }
+
+    case ast::ast_node_type::E_UNARY_EXPRESSION: {
+      auto &un = static_cast<ast::unary_expression &>(ref);
+      auto operand = constant_value(un.expr());
+      if (operand) return make_constant(ast::evaluate_unary_operation(un.op_type(), *operand), ref);
+      break;
+    }
+
+    default: break;
+    }
+
+    return ref;
+  }
+
+  ast::i_ast_node &fold_statement(ast::i_ast_node &ref) {
+    apply(ref);
+
+    switch (ast::identify_node(ref)) {
+    case ast::ast_node_type::E_IF_STATEMENT: {
+      auto &if_st = static_cast<ast::if_statement &>(ref);
+      auto cond = constant_value(*if_st.cond());
+      if (!cond) break;
+      if (*cond) return *if_st.true_block();
+      if (if_st.else_block()) return *if_st.else_block();
+      return m_ast.make_node<ast::statement_block>();
+    }
+
+    case ast::ast_node_type::E_WHILE_STATEMENT: {
+      auto &while_st = static_cast<ast::while_statement &>(ref);
+      auto cond = constant_value(*while_st.cond());
+      if (cond && !*cond) return m_ast.make_node<ast::statement_block>();
+      break;
+    }
+
+    default: break;
+    }
+
+    return ref;
+  }
+
+  template <typename t_block> void fold_block(t_block &ref) {
+    for (auto &st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      st = &fold_statement(*st);
+    }
+  }
+
+public:
+  constant_binder(
+      ast::ast_container &ast, const utils::transparent::string_unordered_map<int> &bound
+  )
+      : m_ast{ast}, m_bound{bound} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void bind(ast::statement_block &ref) { fold_block(ref); }
+  void bind(ast::value_block &ref) { fold_block(ref); }
+
+  void bind(ast::if_statement &ref) {
+    ref.set_cond(fold(*ref.cond()));
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void bind(ast::while_statement &ref) {
+    ref.set_cond(fold(*ref.cond()));
+    apply(*ref.block());
+  }
+
+  void bind(ast::binary_expression &ref) {
+    ref.set_left(fold(ref.left()));
+    ref.set_right(fold(ref.right()));
+  }
+
+  void bind(ast::assignment_statement &ref) {
+    for (auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) bind(*sub);
+    }
+    ref.set_right(fold(ref.right()));
+  }
+
+  void bind(ast::print_statement &ref) { ref.set_expr(fold(ref.expr())); }
+  void bind(ast::unary_expression &ref) { ref.set_expr(fold(ref.expr())); }
+  void bind(ast::subscript &ref) { ref.set_subscript(fold(*ref.get_subscript())); }
+
+  void bind(ast::return_statement &ref) {
+    if (!ref.empty()) ref.set_expr(fold(ref.expr()));
+  }
+
+  void bind(ast::function_call &ref) {
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+      ref.set_parameter(i, fold(**std::next(ref.begin(), i)));
+    }
+  }
+
+  void bind(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(bind);
+};
+
+bool matches(const binding &bound, const ast::function_call &call) {
+  auto arg = call.begin();
+  return std::all_of(bound.begin(), bound.end(), [&arg](auto &&value) {
+    return !value || constant_value(**arg++) == value;
+  });
+}
+
+} // namespace
+
+unsigned
+function_specializer::specialize(ast::ast_container &ast, functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  call_collector collector;
+  collector.apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    collector.collect_function(*attr.definition);
+  }
+
+  struct group {
+    ast::function_definition *callee;
+    binding bound;
+    std::vector<const call_site *> sites;
+    bool hot = false;
+  };
+
+  // Groups are kept in the order of their first call, so that the clones get stable names.
+  std::vector<group> groups;
+  std::map<std::pair<const ast::function_definition *, binding>, std::size_t> group_index;
+  std::unordered_map<const ast::function_definition *, body_summary> summaries;
+
+  for (const auto &site : collector.calls) {
+    auto *callee = site.call->m_def;
+    if (!callee || callee->size() != site.call->size()) continue;
+
+    auto [found, inserted] = summaries.try_emplace(callee);
+    if (inserted) found->second.count(callee->body());
+    const auto &summary = found->second;
+    if (summary.size > max_callee_size) continue;
+
+    binding bound;
+    auto arg = site.call->begin();
+    for (const auto &param : *callee) {
+      auto value = constant_value(**arg++);
+      const bool bindable =
+          param.type == types::type_builtin::type_int && !summary.assigned.contains(param.name());
+      bound.push_back(bindable ? value : std::nullopt);
+    }
+
+    const auto is_bound = [](auto &&value) { return value.has_value(); };
+    if (std::none_of(bound.begin(), bound.end(), is_bound)) continue;
+
+    auto [index, added] = group_index.try_emplace({callee, bound}, groups.size());
+    if (added) groups.push_back({callee, std::move(bound), {}, false});
+    auto &grp = groups[index->second];
+    grp.sites.push_back(&site);
+    grp.hot = grp.hot || site.hot;
+  }
+
+  unsigned redirected = 0, used = 0;
+  for (auto &grp : groups) {
+    if (!grp.hot && grp.sites.size() < min_sites) continue;
+
+    const auto size = summaries.at(grp.callee).size;
+    if (used + size > m_budget) continue;
+    used += size;
+
+    const auto &name = grp.callee->name.value();
+    const auto clone_name = fmt::format("$spec-{}-{}", m_specialized++, name);
+    auto &copy = ast::clone_function(*grp.callee, clone_name, ast);
+
+    utils::transparent::string_unordered_map<int> bound;
+    auto value = grp.bound.begin();
+    for (const auto &param : copy) {
+      if (*value) bound.emplace(param.name(), **value);
+      ++value;
+    }
+
+    constant_binder binder = {ast, bound};
+    binder.apply(copy.body());
+
+    // Recursive calls that pass the same constants stay in the clone.
+    call_collector inner;
+    inner.collect_function(copy);
+    for (auto &site : inner.calls) {
+      if (site.call->m_def != grp.callee || !matches(grp.bound, *site.call)) continue;
+      site.call->m_def = &copy;
+    }
+
+    auto attr = functions.named_functions.lookup(name);
+    functions.add_function(copy, grp.sites.front()->caller, attr && attr->recursive);
+
+    for (const auto *site : grp.sites) {
+      site->call->m_def = &copy;
+      ++redirected;
+    }
+  }
+
+  return redirected;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,204 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/loop_invariant_mover.hpp"
+
+#include "frontend/analysis/assignment_collector.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include "utils/misc.hpp"
+#include "utils/transparent.hpp"
+
+#include <fmt/core.h>
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+// Tells if an expression has the same value on every iteration and can't fail.
+class invariance_checker final
+    : public ezvis::visitor_base<const ast::i_ast_node, invariance_checker, bool> {
+  const utils::transparent::string_unordered_set &m_assigned;
+
+public:
+  invariance_checker(const utils::transparent::string_unordered_set &assigned)
+      : m_assigned{assigned} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  bool is_invariant(const ast::constant_expression &) { return true; }
+
+  bool is_invariant(const ast::variable_expression &ref) {
+    return !m_assigned.contains(ref.name());
+  }
+
+  bool is_invariant(const ast::unary_expression &ref) { return apply(ref.expr()); }
+
+  bool is_invariant(const ast::binary_expression &ref) {
+    using ast::binary_operation;
+    if (ref.op_type() == binary_operation::E_BIN_OP_DIV ||
+        ref.op_type() == binary_operation::E_BIN_OP_MOD) {
+      return false;
+    }
+    return apply(ref.left()) && apply(ref.right());
+  }
+
+  bool is_invariant(const ast::i_ast_node &) { return false; }
+
+  EZVIS_VISIT_INVOKER(is_invariant);
+};
+
+// Replaces the largest invariant subexpressions of a loop with temporaries and collects the
+// assignments that have to be placed before the loop.
+class invariant_hoister final
+    : public ezvis::visitor_base<ast::i_ast_node, invariant_hoister, void> {
+  ast::ast_container &m_ast;
+  symtab &m_stab; // Symbol table of the block that contains the loop
+  invariance_checker m_checker;
+  unsigned &m_counter;
+
+public:
+  std::vector<ast::assignment_statement *> hoisted;
+
+private:
+  static bool worth_hoisting(const ast::i_expression &ref) {
+    using ast::ast_node_type;
+    switch (ast::identify_node(ref)) {
+    case ast_node_type::E_BINARY_EXPRESSION: return true;
+    case ast_node_type::E_UNARY_EXPRESSION: {
+      auto &unary = static_cast<const ast::unary_expression &>(ref);
+      return ast::identify_node(unary.expr()) != ast_node_type::E_CONSTANT_EXPRESSION;
+    }
+    default: return false;
+    }
+  }
+
+  ast::i_expression &hoist_expr(ast::i_expression &ref) {
+    if (!worth_hoisting(ref) || !m_checker.apply(ref)) {
+      apply(ref);
+      return ref;
+    }
+
+    auto name = fmt::format("$licm-{}", m_counter++);
+    auto &def = m_ast.make_node<ast::variable_expression>(name, ref.type, ref.loc());
+    auto &init = m_ast.make_node<ast::assignment_statement>(def, ref, ref.loc());
+    init.type = ref.type;
+
+    m_stab.declare(name, &def);
+    hoisted.push_back(&init);
+    return m_ast.make_node<ast::variable_expression>(name, ref.type, ref.loc());
+  }
+
+  template <typename t_block> void hoist_in_block(t_block &ref) {
+    for (auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      apply(*st);
+    }
+  }
+
+public:
+  invariant_hoister(
+      ast::ast_container &ast, symtab &stab, const utils::transparent::string_unordered_set &assigned,
+      unsigned &counter
+  )
+      : m_ast{ast}, m_stab{stab}, m_checker{assigned}, m_counter{counter} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void hoist(ast::statement_block &ref) { hoist_in_block(ref); }
+  void hoist(ast::value_block &ref) { hoist_in_block(ref); }
+
+  void hoist(ast::if_statement &ref) {
+    ref.set_cond(hoist_expr(*ref.cond()));
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void hoist(ast::while_statement &ref) {
+    ref.set_cond(hoist_expr(*ref.cond()));
+    apply(*ref.block());
+  }
+
+  void hoist(ast::binary_expression &ref) {
+    ref.set_left(hoist_expr(ref.left()));
+    ref.set_right(hoist_expr(ref.right()));
+  }
+
+  void hoist(ast::assignment_statement &ref) { ref.set_right(hoist_expr(ref.right())); }
+  void hoist(ast::print_statement &ref) { ref.set_expr(hoist_expr(ref.expr())); }
+  void hoist(ast::unary_expression &ref) { ref.set_expr(hoist_expr(ref.expr())); }
+  void hoist(ast::subscript &ref) { ref.set_subscript(hoist_expr(*ref.get_subscript())); }
+
+  void hoist(ast::return_statement &ref) {
+    if (!ref.empty()) ref.set_expr(hoist_expr(ref.expr()));
+  }
+
+  void hoist(ast::function_call &ref) {
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+      ref.set_parameter(i, hoist_expr(**std::next(ref.begin(), i)));
+    }
+  }
+
+  void hoist(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(hoist);
+};
+
+} // namespace
+
+template <typename t_block> void loop_invariant_mover::move_in_block(t_block &ref) {
+  for (auto start = ref.begin(); start != ref.end(); ++start) {
+    assert(*start && "Broken statement pointer in a block");
+    apply(**start); // Inner loops go first, their temporaries stay in the enclosing loop body
+
+    // clang-format off
+    auto *loop = ezvis::visit<ast::while_statement *, ast::while_statement, ast::i_ast_node>(
+        ::utils::visitors{
+            [](ast::while_statement &w) { return &w; },
+            [](ast::i_ast_node &) -> ast::while_statement * { return nullptr; }},
+        **start
+    ); // clang-format on
+    if (!loop) continue;
+
+    const auto assigned = assignment_collector{*m_functions}.collect_all(*loop);
+    invariant_hoister hoister = {*m_ast, ref.stab, assigned, m_hoisted};
+    hoister.apply(*loop);
+
+    const auto &hoisted = hoister.hoisted;
+    start = std::next(ref.insert(start, hoisted.begin(), hoisted.end()), hoisted.size());
+  }
+}
+
+unsigned
+loop_invariant_mover::hoist_all(ast::ast_container &ast, const functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  m_ast = &ast;
+  m_functions = &functions;
+  m_hoisted = 0;
+
+  apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    apply(attr.definition->body());
+  }
+
+  return m_hoisted;
+}
+
+} // namespace paracl::frontend
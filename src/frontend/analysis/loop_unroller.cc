@@ -0,0 +1,498 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/loop_unroller.hpp"
+
+#include "frontend/analysis/assignment_collector.hpp"
+#include "frontend/analysis/loop_body.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+#include "frontend/ast/typed_ast_copier.hpp"
+
+#include "utils/misc.hpp"
+#include "utils/transparent.hpp"
+
+#include <fmt/core.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+using ast::binary_operation;
+
+struct induction_variable {
+  std::string name;
+  int step;
+  binary_operation op;            // How the variable is compared with the bound
+  const ast::i_expression *bound; // A constant or a variable that is not assigned in the loop
+  std::optional<int> const_bound;
+};
+
+const ast::variable_expression *as_variable(const ast::i_expression &ref) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_VARIABLE_EXPRESSION) return nullptr;
+  auto &var = static_cast<const ast::variable_expression &>(ref);
+  return (var.type == types::type_builtin::type_int ? &var : nullptr);
+}
+
+std::optional<int> as_constant(const ast::i_expression &ref) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_CONSTANT_EXPRESSION) return std::nullopt;
+  return static_cast<const ast::constant_expression &>(ref).value();
+}
+
+bool is_variable(const ast::i_expression &ref, std::string_view name) {
+  auto *var = as_variable(ref);
+  return var && var->name() == name;
+}
+
+// Recognizes `i = i + c`, `i = c + i` and `i = i - c`. Returns the step.
+std::optional<int> step_of(const ast::i_ast_node &ref, std::string_view name) {
+  if (ast::identify_node(ref) != ast::ast_node_type::E_ASSIGNMENT_STATEMENT) return std::nullopt;
+  auto &assign = static_cast<const ast::assignment_statement &>(ref);
+  if (assign.size() != 1) return std::nullopt;
+
+  auto *left = std::get_if<ast::variable_expression>(&*assign.begin());
+  if (!left || left->name() != name) return std::nullopt;
+
+  auto &right = assign.right();
+  if (ast::identify_node(right) != ast::ast_node_type::E_BINARY_EXPRESSION) return std::nullopt;
+  auto &step = static_cast<const ast::binary_expression &>(right);
+
+  switch (step.op_type()) {
+  case binary_operation::E_BIN_OP_ADD:
+    if (is_variable(step.left(), name)) return as_constant(step.right());
+    if (is_variable(step.right(), name)) return as_constant(step.left());
+    return std::nullopt;
+  case binary_operation::E_BIN_OP_SUB: {
+    if (!is_variable(step.left(), name)) return std::nullopt;
+    auto value = as_constant(step.right());
+    if (!value || value == std::numeric_limits<int>::min()) return std::nullopt;
+    return -*value;
+  }
+  default: return std::nullopt;
+  }
+}
+
+std::optional<induction_variable>
+find_induction_variable(const ast::while_statement &loop, const functions_analytics &functions) {
+  const auto &body = loop_body(loop);
+  if (!body.size()) return std::nullopt;
+
+  auto &cond = *loop.cond();
+  if (ast::identify_node(cond) != ast::ast_node_type::E_BINARY_EXPRESSION) return std::nullopt;
+  auto &compare = static_cast<const ast::binary_expression &>(cond);
+
+  const auto op = compare.op_type();
+  const bool increasing =
+      (op == binary_operation::E_BIN_OP_LS || op == binary_operation::E_BIN_OP_LE);
+  const bool decreasing =
+      (op == binary_operation::E_BIN_OP_GT || op == binary_operation::E_BIN_OP_GE);
+  if (!increasing && !decreasing) return std::nullopt;
+
+  auto *var = as_variable(compare.left());
+  if (!var) return std::nullopt;
+
+  induction_variable iv = {std::string{var->name()}, 0, op, &compare.right(), std::nullopt};
+  auto step = step_of(*body.back(), iv.name);
+  if (!step || *step == 0 || (*step > 0) != increasing) return std::nullopt;
+  iv.step = *step;
+
+  // The last statement has to be the only place the variable changes.
+  assignment_collector collector = {functions};
+  collector.apply(cond);
+  for (auto start = body.cbegin(), finish = std::prev(body.cend()); start != finish; ++start) {
+    assert(*start && "Broken statement pointer in a block");
+    collector.apply(**start);
+  }
+
+  const auto assigned = collector.take_assigned();
+  if (assigned.contains(iv.name)) return std::nullopt;
+
+  iv.const_bound = as_constant(*iv.bound);
+  if (iv.const_bound) return iv;
+
+  // With a variable bound the limit of the unrolled loop can saturate, which is only correct for
+  // strict comparisons.
+  auto *bound = as_variable(*iv.bound);
+  if (!bound || bound->name() == iv.name || assigned.contains(bound->name())) return std::nullopt;
+  const bool strict = (op == binary_operation::E_BIN_OP_LS || op == binary_operation::E_BIN_OP_GT);
+  return (strict ? std::optional{iv} : std::nullopt);
+}
+
+// Size of a loop body in AST nodes and whether it contains other loops.
+class body_summary final : public ezvis::visitor_base<const ast::i_ast_node, body_summary, void> {
+public:
+  unsigned size = 0;
+  bool has_loops = false;
+
+private:
+  template <typename t_block> void summarize_block(const t_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      count(*st);
+    }
+  }
+
+  void count(const ast::i_ast_node &ref) {
+    ++size;
+    apply(ref);
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void summarize(const ast::statement_block &ref) { summarize_block(ref); }
+  void summarize(const ast::value_block &ref) { summarize_block(ref); }
+
+  void summarize(const ast::if_statement &ref) {
+    count(*ref.cond());
+    count(*ref.true_block());
+    if (ref.else_block()) count(*ref.else_block());
+  }
+
+  void summarize(const ast::while_statement &) { has_loops = true; }
+
+  void summarize(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      if (auto *sub = std::get_if<ast::subscript>(&left)) count(*sub->get_subscript());
+    }
+    count(ref.right());
+  }
+
+  void summarize(const ast::function_call &ref) {
+    for (const auto *arg : ref) {
+      assert(arg);
+      count(*arg);
+    }
+  }
+
+  void summarize(const ast::binary_expression &ref) {
+    count(ref.left());
+    count(ref.right());
+  }
+
+  void summarize(const ast::print_statement &ref) { count(ref.expr()); }
+  void summarize(const ast::unary_expression &ref) { count(ref.expr()); }
+  void summarize(const ast::subscript &ref) { count(*ref.get_subscript()); }
+
+  void summarize(const ast::return_statement &ref) {
+    if (!ref.empty()) count(ref.expr());
+  }
+
+  void summarize(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(summarize);
+};
+
+// Finds products of the induction variable and a constant. When given the temporaries, replaces
+// the products with them.
+class product_reducer final : public ezvis::visitor_base<ast::i_ast_node, product_reducer, void> {
+  std::string_view m_name;
+  ast::ast_container *m_ast = nullptr;
+  const std::map<int, std::string> *m_temporaries = nullptr;
+
+public:
+  std::map<int, unsigned> uses;
+
+private:
+  std::optional<int> factor_of(const ast::i_expression &ref) const {
+    if (ast::identify_node(ref) != ast::ast_node_type::E_BINARY_EXPRESSION) return std::nullopt;
+    auto &product = static_cast<const ast::binary_expression &>(ref);
+    if (product.op_type() != binary_operation::E_BIN_OP_MUL) return std::nullopt;
+    if (is_variable(product.left(), m_name)) return as_constant(product.right());
+    if (is_variable(product.right(), m_name)) return as_constant(product.left());
+    return std::nullopt;
+  }
+
+  ast::i_expression &reduce_expr(ast::i_expression &ref) {
+    auto factor = factor_of(ref);
+    if (!factor) {
+      apply(ref);
+      return ref;
+    }
+
+    if (!m_temporaries) {
+      ++uses[*factor];
+      return ref;
+    }
+
+    auto found = m_temporaries->find(*factor);
+    if (found == m_temporaries->end()) return ref;
+    return m_ast->make_node<ast::variable_expression>(found->second, ref.type, ref.loc());
+  }
+
+  template <typename t_block> void reduce_in_block(t_block &ref) {
+    for (auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      apply(*st);
+    }
+  }
+
+public:
+  product_reducer(std::string_view name) : m_name{name} {}
+
+  void set_temporaries(ast::ast_container &ast, const std::map<int, std::string> &temporaries) {
+    m_ast = &ast;
+    m_temporaries = &temporaries;
+  }
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void reduce(ast::statement_block &ref) { reduce_in_block(ref); }
+  void reduce(ast::value_block &ref) { reduce_in_block(ref); }
+
+  void reduce(ast::if_statement &ref) {
+    ref.set_cond(reduce_expr(*ref.cond()));
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void reduce(ast::binary_expression &ref) {
+    ref.set_left(reduce_expr(ref.left()));
+    ref.set_right(reduce_expr(ref.right()));
+  }
+
+  void reduce(ast::assignment_statement &ref) { ref.set_right(reduce_expr(ref.right())); }
+  void reduce(ast::print_statement &ref) { ref.set_expr(reduce_expr(ref.expr())); }
+  void reduce(ast::unary_expression &ref) { ref.set_expr(reduce_expr(ref.expr())); }
+  void reduce(ast::subscript &ref) { ref.set_subscript(reduce_expr(*ref.get_subscript())); }
+
+  void reduce(ast::return_statement &ref) {
+    if (!ref.empty()) ref.set_expr(reduce_expr(ref.expr()));
+  }
+
+  void reduce(ast::function_call &ref) {
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+      ref.set_parameter(i, reduce_expr(**std::next(ref.begin(), i)));
+    }
+  }
+
+  void reduce(ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(reduce);
+};
+
+// Rewrites a single counting loop. The statements that have to be placed before the loop are
+// collected in the prologue.
+class loop_transformer final {
+  ast::ast_container &m_ast;
+  symtab &m_stab; // Symbol table of the block that contains the loop
+  ast::while_statement &m_loop;
+  const induction_variable &m_iv;
+  unsigned &m_temporaries;
+
+public:
+  std::vector<ast::i_ast_node *> prologue;
+
+private:
+  location loc() const { return m_loop.loc(); }
+
+  ast::constant_expression &constant(int value) {
+    return m_ast.make_node<ast::constant_expression>(value, loc());
+  }
+
+  ast::variable_expression &variable(std::string_view name) {
+    return m_ast.make_node<ast::variable_expression>(
+        std::string{name}, types::type_builtin::type_int, loc()
+    );
+  }
+
+  ast::binary_expression &
+  binary(binary_operation op, ast::i_expression &lhs, ast::i_expression &rhs) {
+    auto &result = m_ast.make_node<ast::binary_expression>(op, lhs, rhs, loc());
+    result.type = types::type_builtin::type_int;
+    return result;
+  }
+
+  ast::assignment_statement &assign(std::string_view name, ast::i_expression &value) {
+    auto &result = m_ast.make_node<ast::assignment_statement>(variable(name), value, loc());
+    result.type = types::type_builtin::type_int;
+    return result;
+  }
+
+  std::string declare_temporary(std::string_view prefix) {
+    auto name = fmt::format("${}-{}", prefix, m_temporaries++);
+    auto &def = variable(name);
+    m_stab.declare(name, &def);
+    return name;
+  }
+
+  // The value the variable is compared with in the unrolled loop. Returns nullopt when the loop
+  // can't have `factor` iterations left.
+  ast::i_expression *unrolled_bound(unsigned factor) {
+    const auto offset = std::int64_t{factor - 1} * m_iv.step;
+    if (offset < std::numeric_limits<int>::min() || offset > std::numeric_limits<int>::max()) {
+      return nullptr;
+    }
+
+    if (m_iv.const_bound) {
+      const auto limit = *m_iv.const_bound - offset;
+      if (limit < std::numeric_limits<int>::min() || limit > std::numeric_limits<int>::max()) {
+        return nullptr;
+      }
+      return &constant(static_cast<int>(limit));
+    }
+
+    // $unroll-N = INT_MIN; if (bound >= INT_MIN + offset) $unroll-N = bound - offset;
+    // The comparison is strict, so the saturated limit never lets the unrolled loop run.
+    const bool increasing = (m_iv.step > 0);
+    const auto saturated =
+        (increasing ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max());
+    const auto name = declare_temporary("unroll");
+    const auto bound_name = static_cast<const ast::variable_expression &>(*m_iv.bound).name();
+
+    auto &fits = binary(
+        increasing ? binary_operation::E_BIN_OP_GE : binary_operation::E_BIN_OP_LE,
+        variable(bound_name), constant(static_cast<int>(saturated + offset))
+    );
+
+    auto &limit = binary(
+        binary_operation::E_BIN_OP_SUB, variable(bound_name), constant(static_cast<int>(offset))
+    );
+
+    auto &then = m_ast.make_node<ast::statement_block>();
+    then.append_statement(assign(name, limit));
+
+    prologue.push_back(&assign(name, constant(saturated)));
+    prologue.push_back(&m_ast.make_node<ast::if_statement>(fits, then, loc()));
+    return &variable(name);
+  }
+
+public:
+  loop_transformer(
+      ast::ast_container &ast, symtab &stab, ast::while_statement &loop,
+      const induction_variable &iv, unsigned &temporaries
+  )
+      : m_ast{ast}, m_stab{stab}, m_loop{loop}, m_iv{iv}, m_temporaries{temporaries} {}
+
+  // i * c becomes $sr-N, which starts at i * c and grows by step * c right before i is stepped.
+  bool reduce_strength() {
+    auto &body = loop_body(m_loop);
+    auto last = std::prev(body.end());
+
+    product_reducer reducer = {m_iv.name};
+    for (auto start = body.begin(); start != last; ++start) {
+      reducer.apply(**start);
+    }
+
+    std::map<int, std::string> temporaries;
+    for (const auto &[factor, uses] : reducer.uses) {
+      if (uses < loop_unroller::min_product_uses) continue;
+
+      const auto name = declare_temporary("sr");
+      auto &init = binary(binary_operation::E_BIN_OP_MUL, variable(m_iv.name), constant(factor));
+      prologue.push_back(&assign(name, init));
+
+      const auto step =
+          *ast::evaluate_binary_operation(binary_operation::E_BIN_OP_MUL, m_iv.step, factor);
+      auto &next = binary(binary_operation::E_BIN_OP_ADD, variable(name), constant(step));
+      last = std::next(body.insert(last, &assign(name, next)));
+      temporaries.emplace(factor, name);
+    }
+
+    if (temporaries.empty()) return false;
+
+    reducer.set_temporaries(m_ast, temporaries);
+    for (auto start = body.begin(); start != last; ++start) {
+      reducer.apply(**start);
+    }
+
+    return true;
+  }
+
+  bool unroll(unsigned factor) {
+    if (factor < 2) return false;
+
+    const auto &body = loop_body(m_loop);
+    body_summary summary;
+    summary.apply(body);
+    if (summary.has_loops || summary.size * factor > loop_unroller::max_unrolled_size) return false;
+
+    auto *bound = unrolled_bound(factor);
+    if (!bound) return false;
+
+    auto &block = m_ast.make_node<ast::statement_block>();
+    block.stab = body.stab;
+
+    const ast::typed_ast_copier::rename_map names;
+    ast::typed_ast_copier copier = {m_ast, names};
+    for (unsigned i = 0; i < factor; ++i) {
+      auto &copy = copier.copy(body);
+      for (auto *st : copy) {
+        block.append_statement(*st);
+      }
+    }
+
+    auto &cond = binary(m_iv.op, variable(m_iv.name), *bound);
+    auto &unrolled = m_ast.make_node<ast::while_statement>(cond, block, loc());
+    unrolled.symbol_table = m_loop.symbol_table;
+
+    prologue.push_back(&unrolled);
+    return true;
+  }
+};
+
+} // namespace
+
+template <typename t_block> void loop_unroller::unroll_in_block(t_block &ref) {
+  for (auto start = ref.begin(); start != ref.end(); ++start) {
+    assert(*start && "Broken statement pointer in a block");
+    apply(**start); // Inner loops go first
+
+    // clang-format off
+    auto *loop = ezvis::visit<ast::while_statement *, ast::while_statement, ast::i_ast_node>(
+        ::utils::visitors{
+            [](ast::while_statement &w) { return &w; },
+            [](ast::i_ast_node &) -> ast::while_statement * { return nullptr; }},
+        **start
+    ); // clang-format on
+    if (!loop) continue;
+
+    auto iv = find_induction_variable(*loop, *m_functions);
+    if (!iv) continue;
+
+    loop_transformer transformer = {*m_ast, ref.stab, *loop, *iv, m_temporaries};
+    const bool reduced = transformer.reduce_strength();
+    const bool unrolled = transformer.unroll(m_factor);
+    if (reduced || unrolled) ++m_transformed;
+
+    const auto &prologue = transformer.prologue;
+    start = std::next(ref.insert(start, prologue.begin(), prologue.end()), prologue.size());
+  }
+}
+
+unsigned loop_unroller::unroll_all(ast::ast_container &ast, const functions_analytics &functions) {
+  auto *root = ast.get_root_ptr();
+  if (!root) return 0;
+
+  m_ast = &ast;
+  m_functions = &functions;
+  m_transformed = 0;
+
+  apply(*root);
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    apply(attr.definition->body());
+  }
+
+  return m_transformed;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,386 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/partial_evaluator.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+// Thrown when the evaluation hits something that has to be left for runtime.
+struct evaluation_stopped {};
+
+using array_ptr = std::shared_ptr<std::vector<int>>;
+using value = std::variant<std::monostate, int, ast::function_definition *, array_ptr>;
+using variable_map = std::unordered_map<const ast::variable_expression *, value>;
+
+bool is_void(const types::generic_type &type) {
+  return !type || type == types::type_builtin::type_void;
+}
+
+bool is_array(const types::generic_type &type) {
+  return type && type.base().get_class() == types::type_class::E_ARRAY;
+}
+
+class interpreter final : public ezvis::visitor_base<const ast::i_ast_node, interpreter, value> {
+  struct frame {
+    std::vector<const symtab *> scopes;
+    variable_map variables;
+  };
+
+  const symtab &m_global_stab;
+  std::vector<frame> m_frames;   // The first one is main
+  std::optional<value> m_return; // Set while a `return` looks for its block
+  unsigned m_steps;
+
+public:
+  std::vector<int> output;
+
+  struct snapshot {
+    variable_map globals;
+    std::size_t output_size;
+  };
+
+private:
+  void tick() {
+    if (!m_steps) throw evaluation_stopped{};
+    --m_steps;
+  }
+
+  static int to_int(const value &val) {
+    if (auto *ptr = std::get_if<int>(&val)) return *ptr;
+    throw evaluation_stopped{};
+  }
+
+  std::pair<variable_map *, const ast::variable_expression *> resolve(std::string_view name) {
+    auto &scopes = m_frames.back().scopes;
+    for (auto start = scopes.rbegin(), finish = scopes.rend(); start != finish; ++start) {
+      if (auto attr = (*start)->get_attributes(name); attr) {
+        return {&m_frames.back().variables, attr->m_definition};
+      }
+    }
+
+    // Functions can only see the variables of main's global scope.
+    if (auto attr = m_global_stab.get_attributes(name); attr) {
+      return {&m_frames.front().variables, attr->m_definition};
+    }
+
+    throw evaluation_stopped{};
+  }
+
+  value load(std::string_view name) {
+    auto [variables, def] = resolve(name);
+    auto found = variables->find(def);
+    if (found == variables->end()) return 0; // Frames are zeroed
+    return found->second;
+  }
+
+  std::vector<int> &load_array(std::string_view name) {
+    auto val = load(name);
+    auto *ptr = std::get_if<array_ptr>(&val);
+    if (!ptr) throw evaluation_stopped{};
+    return **ptr;
+  }
+
+  int &element(std::string_view name, const ast::i_expression &index_expr) {
+    auto &arr = load_array(name);
+    const auto index = to_int(apply(index_expr));
+    if (index < 0 || static_cast<std::size_t>(index) >= arr.size()) throw evaluation_stopped{};
+    return arr[index];
+  }
+
+  // Global arrays become one assignment per element, see evaluate. Writes to the large ones are
+  // left to the program.
+  int &store_element(std::string_view name, const ast::i_expression &index_expr) {
+    auto *def = resolve(name).second;
+    auto global = m_global_stab.get_attributes(name);
+    if (global && global->m_definition == def) {
+      auto &type = static_cast<const types::type_array &>(def->type.base());
+      if (type.size > partial_evaluator::max_baked_array) throw evaluation_stopped{};
+    }
+    return element(name, index_expr);
+  }
+
+  void begin_scope(const symtab &stab) {
+    m_frames.back().scopes.push_back(&stab);
+    for (const auto &[name, attr] : stab) {
+      if (!attr.m_definition || !is_array(attr.m_definition->type)) continue;
+      auto &type = static_cast<const types::type_array &>(attr.m_definition->type.base());
+      m_frames.back().variables[attr.m_definition] = std::make_shared<std::vector<int>>(type.size);
+    }
+  }
+
+  void end_scope() { m_frames.back().scopes.pop_back(); }
+
+  template <typename t_block> void execute_block(const t_block &ref) {
+    begin_scope(ref.stab);
+    for (const auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      tick();
+      apply(*st);
+      if (m_return) break;
+    }
+    end_scope();
+  }
+
+public:
+  interpreter(const symtab &global_stab, unsigned budget)
+      : m_global_stab{global_stab}, m_frames(1), m_steps{budget} {
+    begin_scope(global_stab);
+  }
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  value eval(const ast::constant_expression &ref) { return ref.value(); }
+  value eval(const ast::variable_expression &ref) { return load(ref.name()); }
+  value eval(const ast::function_definition_to_ptr_conv &ref) { return &ref.definition(); }
+  value eval(const ast::function_definition &) { return {}; } // Not executable by itself
+
+  value eval(const ast::binary_expression &ref) {
+    const auto left = to_int(apply(ref.left()));
+    const auto right = to_int(apply(ref.right()));
+    auto result = ast::evaluate_binary_operation(ref.op_type(), left, right);
+    if (!result) throw evaluation_stopped{};
+    return *result;
+  }
+
+  value eval(const ast::unary_expression &ref) {
+    return ast::evaluate_unary_operation(ref.op_type(), to_int(apply(ref.expr())));
+  }
+
+  value eval(const ast::subscript &ref) { return element(ref.name(), *ref.get_subscript()); }
+
+  value eval(const ast::assignment_statement &ref) {
+    auto val = apply(ref.right());
+
+    for (auto start = ref.rbegin(), finish = ref.rend(); start != finish; ++start) {
+      if (std::holds_alternative<ast::subscript>(*start)) {
+        auto &sub = std::get<ast::subscript>(*start);
+        store_element(sub.name(), *sub.get_subscript()) = to_int(val);
+        continue;
+      }
+
+      auto &var = std::get<ast::variable_expression>(*start);
+      if (is_array(var.type)) continue; // Arrays are zero-filled when their scope is entered
+      auto [variables, def] = resolve(var.name());
+      (*variables)[def] = val;
+    }
+
+    return val;
+  }
+
+  value eval(const ast::print_statement &ref) {
+    output.push_back(to_int(apply(ref.expr())));
+    if (output.size() > partial_evaluator::max_prints) throw evaluation_stopped{};
+    return {};
+  }
+
+  value eval(const ast::statement_block &ref) {
+    execute_block(ref);
+    return {};
+  }
+
+  value eval(const ast::value_block &ref) {
+    execute_block(ref);
+    if (is_void(ref.type)) return {}; // `return` leaves the enclosing block, like in the bytecode
+    if (!m_return) throw evaluation_stopped{};
+    return std::exchange(m_return, std::nullopt).value();
+  }
+
+  value eval(const ast::return_statement &ref) {
+    m_return = (ref.empty() ? value{} : apply(ref.expr()));
+    return {};
+  }
+
+  value eval(const ast::if_statement &ref) {
+    begin_scope(ref.control_block_symtab);
+    if (to_int(apply(*ref.cond()))) apply(*ref.true_block());
+    else if (ref.else_block()) apply(*ref.else_block());
+    end_scope();
+    return {};
+  }
+
+  value eval(const ast::while_statement &ref) {
+    begin_scope(ref.symbol_table);
+    while (!m_return) {
+      tick();
+      if (!to_int(apply(*ref.cond()))) break;
+      apply(*ref.block());
+    }
+    end_scope();
+    return {};
+  }
+
+  value eval(const ast::function_call &ref) {
+    tick();
+
+    std::vector<value> args;
+    for (const auto *arg : ref) {
+      assert(arg);
+      args.push_back(apply(*arg));
+    }
+
+    auto *def = ref.m_def;
+    if (!def) { // Call through a function pointer
+      auto callee = load(ref.name());
+      auto *ptr = std::get_if<ast::function_definition *>(&callee);
+      if (!ptr) throw evaluation_stopped{};
+      def = *ptr;
+    }
+
+    if (args.size() != def->size() || m_frames.size() > partial_evaluator::max_depth) {
+      throw evaluation_stopped{};
+    }
+
+    frame callee_frame;
+    callee_frame.scopes.push_back(&def->param_stab);
+    auto arg = args.begin();
+    for (const auto &param : *def) {
+      callee_frame.variables[def->param_stab.get_attributes(param.name())->m_definition] = *arg++;
+    }
+
+    m_frames.push_back(std::move(callee_frame));
+    auto result = apply(def->body());
+    if (m_return) result = std::exchange(m_return, std::nullopt).value();
+    m_frames.pop_back();
+
+    return result;
+  }
+
+  value eval(const ast::read_expression &) { throw evaluation_stopped{}; } // Depends on the input
+  value eval(const ast::i_ast_node &) { throw evaluation_stopped{}; }
+
+  EZVIS_VISIT_INVOKER(eval);
+
+  void execute(const ast::i_ast_node &ref) {
+    tick();
+    apply(ref);
+    if (m_return) throw evaluation_stopped{}; // Returns from main
+  }
+
+  const variable_map &globals() const { return m_frames.front().variables; }
+
+  snapshot save() const {
+    snapshot saved = {globals(), output.size()};
+    for (auto &[def, val] : saved.globals) {
+      if (auto *arr = std::get_if<array_ptr>(&val)) *arr = std::make_shared<std::vector<int>>(**arr);
+    }
+    return saved;
+  }
+
+  void restore(snapshot saved) {
+    m_frames.resize(1);
+    m_frames.front().variables = std::move(saved.globals);
+    output.resize(saved.output_size);
+    m_return.reset();
+  }
+};
+
+} // namespace
+
+unsigned partial_evaluator::evaluate(ast::ast_container &ast) {
+  auto *root_ptr = ast.get_root_ptr();
+  if (!root_ptr) return 0;
+
+  auto &root = static_cast<ast::statement_block &>(*root_ptr);
+  interpreter interp = {root.stab, m_budget};
+
+  unsigned evaluated = 0;
+  for (auto *st : root) {
+    assert(st && "Broken statement pointer in a block");
+    auto saved = interp.save();
+    try {
+      interp.execute(*st);
+    } catch (evaluation_stopped &) {
+      interp.restore(std::move(saved));
+      break;
+    }
+    ++evaluated;
+  }
+
+  if (!evaluated) return 0;
+
+  const auto prefix_end = std::next(root.begin(), evaluated);
+  const auto loc = (*root.begin())->loc();
+  std::vector<ast::i_ast_node *> replacement;
+
+  // Definitions aren't executed, keep them where they were.
+  std::copy_if(root.begin(), prefix_end, std::back_inserter(replacement), [](auto *st) {
+    return ast::identify_node(*st) == ast::ast_node_type::E_FUNCTION_DEFINITION;
+  });
+
+  for (const auto printed : interp.output) {
+    auto &constant = ast.make_node<ast::constant_expression>(printed, loc);
+    replacement.push_back(&ast.make_node<ast::print_statement>(constant, loc));
+  }
+
+  std::vector<std::pair<unsigned, ast::variable_expression *>> globals;
+  for (const auto &[name, attr] : root.stab) {
+    if (!interp.globals().contains(attr.m_definition)) continue;
+    globals.emplace_back(attr.m_loc, attr.m_definition);
+  }
+  std::sort(globals.begin(), globals.end());
+
+  auto assign = [&ast, &replacement, loc](auto left, ast::i_expression &right) {
+    auto &init = ast.make_node<ast::assignment_statement>(left, right, loc);
+    init.type = right.type;
+    replacement.push_back(&init);
+  };
+
+  for (const auto &[index, def] : globals) {
+    const auto &val = interp.globals().at(def);
+
+    const std::string name{def->name()};
+    const bool is_int = def->type && def->type == types::type_builtin::type_int;
+
+    if (auto *integer = std::get_if<int>(&val); integer && is_int) {
+      auto &constant = ast.make_node<ast::constant_expression>(*integer, loc);
+      assign(ast::variable_expression{name, def->type, loc}, constant);
+    }
+
+    else if (auto *func = std::get_if<ast::function_definition *>(&val)) {
+      auto &conv = ast.make_node<ast::function_definition_to_ptr_conv>(**func, loc);
+      conv.type = types::generic_type::make<types::type_composite_function>((*func)->type);
+      assign(ast::variable_expression{name, def->type, loc}, conv);
+    }
+
+    else if (auto *arr = std::get_if<array_ptr>(&val)) {
+      for (std::size_t i = 0; i < (*arr)->size(); ++i) {
+        if (!(**arr)[i]) continue; // Arrays start zero-filled
+        auto &index_expr = ast.make_node<ast::constant_expression>(static_cast<int>(i), loc);
+        auto &constant = ast.make_node<ast::constant_expression>((**arr)[i], loc);
+        assign(ast::subscript{name, &index_expr, loc}, constant);
+      }
+    }
+  }
+
+  root.erase(root.begin(), prefix_end);
+  root.insert(root.begin(), replacement.begin(), replacement.end());
+  return evaluated;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,176 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/purity_analyzer.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/types/types.hpp"
+
+#include "utils/transparent.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace paracl::frontend {
+
+namespace {
+
+// Looks for side effects inside of a single function body and collects its direct callees.
+class purity_checker final
+    : public ezvis::visitor_base<const ast::i_ast_node, purity_checker, void> {
+public:
+  bool pure = true;
+  std::vector<const ast::function_definition *> callees;
+  utils::transparent::string_unordered_set used, declared;
+
+private:
+  void declare(const symtab &stab) {
+    for (const auto &[name, attr] : stab) {
+      declared.emplace(name);
+    }
+  }
+
+  template <typename t_block> void check_block(const t_block &ref) {
+    declare(ref.stab);
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void check(const ast::statement_block &ref) { check_block(ref); }
+  void check(const ast::value_block &ref) { check_block(ref); }
+
+  void check(const ast::if_statement &ref) {
+    declare(ref.control_block_symtab);
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void check(const ast::while_statement &ref) {
+    declare(ref.symbol_table);
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void check(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      std::visit([this](auto &&var) { apply(var); }, left);
+    }
+    apply(ref.right());
+  }
+
+  void check(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void check(const ast::unary_expression &ref) { apply(ref.expr()); }
+
+  void check(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  void check(const ast::function_call &ref) {
+    if (!ref.m_def) pure = false; // Call through a function pointer
+    else callees.push_back(ref.m_def);
+
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void check(const ast::variable_expression &ref) { used.emplace(ref.name()); }
+  void check(const ast::constant_expression &) {}
+
+  // Nested definitions are checked on their own, conversions to pointers are just constants.
+  void check(const ast::function_definition &) {}
+  void check(const ast::function_definition_to_ptr_conv &) {}
+
+  // `print`, `?`, arrays and error nodes.
+  void check(const ast::i_ast_node &) { pure = false; }
+
+  EZVIS_VISIT_INVOKER(check);
+};
+
+bool is_locally_pure(const ast::function_definition &def, purity_checker &checker) {
+  for (const auto &param : def) {
+    checker.declared.emplace(param.name());
+  }
+
+  checker.apply(def.body());
+  if (!checker.pure) return false;
+
+  // Anything that is not declared inside of the function is a global.
+  return std::all_of(checker.used.begin(), checker.used.end(), [&checker](auto &&name) {
+    return checker.declared.contains(name);
+  });
+}
+
+} // namespace
+
+unsigned purity_analyzer::analyze(functions_analytics &functions) {
+  std::unordered_map<const ast::function_definition *, std::vector<const ast::function_definition *>>
+      candidates;
+
+  for (auto &&[key, attr] : functions.usegraph) {
+    auto &&[name, def] = attr.value;
+    assert(def);
+    if (!functions.named_functions.lookup(name)) continue; // Eliminated as unreachable
+
+    purity_checker checker;
+    if (is_locally_pure(*def, checker)) candidates.emplace(def, std::move(checker.callees));
+  }
+
+  const auto calls_impure = [&candidates](auto &&candidate) {
+    return std::any_of(candidate.second.begin(), candidate.second.end(), [&candidates](auto *callee) {
+      return !candidates.contains(callee);
+    });
+  };
+
+  // Dropping a function can make its callers impure as well, so iterate to a fixpoint.
+  std::size_t dropped;
+  do {
+    dropped = std::erase_if(candidates, calls_impure);
+  } while (dropped);
+
+  for (auto &&[key, attr] : functions.usegraph) {
+    auto &&[name, def] = attr.value;
+    functions.named_functions.set_pure(name, candidates.contains(def));
+  }
+
+  return candidates.size();
+}
+
+bool purity_analyzer::is_memoizable(const function_table::function_attributes &attr) {
+  if (!attr.pure) return false;
+
+  assert(attr.definition);
+  const auto &def = *attr.definition;
+  const auto is_int = [](const types::generic_type &type) {
+    return type == types::type_builtin::type_int;
+  };
+
+  return is_int(def.type.return_type()) &&
+         std::all_of(def.begin(), def.end(), [&is_int](auto &&param) { return is_int(param.type); });
+}
+
+} // namespace paracl::frontend
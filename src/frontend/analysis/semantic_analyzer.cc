@@ -150,12 +150,16 @@ void semantic_analyzer::analyze_node(ast::value_block &ref) {
   m_return_statements = &ref.return_statements;
   ref.return_statements.clear();
 
+  const bool old_tail_position = m_tail_position;
+
   for (auto start = ref.begin(), finish = ref.end(); start != finish; ++start) {
     assert(*start && "Broken statement pointer in a block");
     auto &&stmt = **start;
-    apply(stmt);
 
     bool is_last = (std::next(start) == finish);
+    m_tail_position = is_last;
+    apply(stmt);
+
     if (!is_last) continue;
     /* There we've already reached the last statement of the value block. It may be an implicit
      * return */
@@ -195,17 +199,23 @@ void semantic_analyzer::analyze_node(ast::value_block &ref) {
   ref.type = type;
 
   m_return_statements = old_returns;
+  m_tail_position = old_tail_position;
+  m_scopes.end_scope();
 }
 
 void semantic_analyzer::analyze_node(ast::statement_block &ref) {
   m_scopes.begin_scope(ref.stab);
+  const bool is_tail = m_tail_position;
+
   for (auto start = ref.begin(), finish = ref.end(); start != finish; ++start) {
     assert(*start && "Broken statement pointer in a block");
     auto &&stmt = **start;
-    apply(stmt);
 
     bool is_last = (std::next(start) == finish);
-    if (!is_last || !m_return_statements) continue;
+    m_tail_position = is_tail && is_last;
+    apply(stmt);
+
+    if (!m_tail_position || !m_return_statements) continue;
     /* There we've already reached the last statement of the value block. It may be an implicit
      * return */
 
@@ -239,19 +249,31 @@ void semantic_analyzer::analyze_node(ast::statement_block &ref) {
     /* replace expression node in AST with explicit return statement */
     *start = &ret;
   }
+
+  m_tail_position = is_tail;
+  m_scopes.end_scope();
 }
 
 void semantic_analyzer::analyze_node(ast::if_statement &ref) {
+  const bool is_tail = m_tail_position;
+  m_tail_position = false;
   apply(*ref.cond());
   expect_type_eq(*ref.cond(), type_builtin::type_int.base());
+
+  m_tail_position = is_tail; // Both branches inherit the tail position of the if statement
   apply(*ref.true_block());
+  m_tail_position = is_tail;
   if (ref.else_block()) apply(*ref.else_block());
+  m_tail_position = is_tail;
 }
 
 void semantic_analyzer::analyze_node(ast::while_statement &ref) {
+  const bool is_tail = m_tail_position;
+  m_tail_position = false; // The loop body is never the last statement executed
   apply(*ref.cond());
   expect_type_eq(*ref.cond(), type_builtin::type_int);
   apply(*ref.block());
+  m_tail_position = is_tail;
 }
 
 void semantic_analyzer::analyze_node(ast::subscript &ref) {
@@ -369,7 +391,9 @@ bool semantic_analyzer::analyze_main(ast::i_ast_node &ref) {
   if (block_ptr) {
     auto &main_block = *block_ptr;
     m_functions->global_stab = &main_block.stab;
+    m_return_statements = &main_block.return_statements; // `return` in main ends the program
     analyze_node(main_block);
+    m_return_statements = nullptr;
 
     for (const auto *st : main_block.return_statements) {
       assert(st);
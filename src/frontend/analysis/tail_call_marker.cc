@@ -0,0 +1,55 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/analysis/tail_call_marker.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/ast/node_identifier.hpp"
+
+#include "utils/misc.hpp"
+
+#include <cassert>
+
+namespace paracl::frontend {
+
+void tail_call_marker::mark(ast::return_statement &ref) {
+  if (ref.empty()) return;
+
+  auto &expr = ref.expr();
+  if (ast::identify_node(expr) != ast::ast_node_type::E_FUNCTION_CALL) return;
+
+  static_cast<ast::function_call &>(expr).m_tail_call = true;
+  ++m_marked;
+}
+
+unsigned tail_call_marker::mark_all(functions_analytics &functions) {
+  m_marked = 0;
+
+  for (auto &&[name, attr] : functions.named_functions) {
+    assert(attr.definition);
+    // Only the statements of the body value block return from the function.
+    auto *body = ezvis::visit<ast::value_block *, ast::value_block, ast::i_ast_node>(
+        ::utils::visitors{
+            [](ast::value_block &block) { return &block; },
+            [](ast::i_ast_node &) -> ast::value_block * { return nullptr; }},
+        attr.definition->body()
+    );
+    if (!body) continue;
+
+    for (auto *st : *body) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+  return m_marked;
+}
+
+} // namespace paracl::frontend
@@ -0,0 +1,183 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "frontend/ast/typed_ast_copier.hpp"
+#include "frontend/ast/ast_nodes.hpp"
+
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+namespace paracl::frontend::ast {
+
+std::string typed_ast_copier::rename(std::string_view name) const {
+  auto found = m_names.find(name);
+  if (found == m_names.end()) return std::string{name};
+  return found->second;
+}
+
+symtab typed_ast_copier::rename(const symtab &stab) const {
+  symtab copy;
+  for (const auto &[name, attr] : stab) {
+    copy.declare(rename(name), attr.m_definition);
+  }
+  return copy;
+}
+
+template <typename t_block> t_block &typed_ast_copier::copy_block(const t_block &ref) {
+  auto &copy = m_container.make_node<t_block>();
+  for (const auto *st : ref) {
+    assert(st);
+    copy.append_statement(apply(*st));
+  }
+  copy.stab = rename(ref.stab);
+  return copy;
+}
+
+statement_block &typed_ast_copier::copy(const statement_block &ref) { return copy_block(ref); }
+
+value_block &typed_ast_copier::copy(const value_block &ref) {
+  auto &copy = copy_block(ref);
+  copy.type = ref.type;
+  return copy;
+}
+
+constant_expression &typed_ast_copier::copy(const constant_expression &ref) {
+  return m_container.make_node<constant_expression>(ref);
+}
+
+read_expression &typed_ast_copier::copy(const read_expression &ref) {
+  return m_container.make_node<read_expression>(ref);
+}
+
+variable_expression &typed_ast_copier::copy(const variable_expression &ref) {
+  return m_container.make_node<variable_expression>(rename(ref.name()), ref.type, ref.loc());
+}
+
+subscript &typed_ast_copier::copy(const subscript &ref) {
+  auto &copy = m_container.make_node<subscript>(
+      rename(ref.name()), &copy_expr(*ref.get_subscript()), ref.loc()
+  );
+  copy.type = ref.type;
+  copy.m_in_bounds = ref.m_in_bounds;
+  return copy;
+}
+
+binary_expression &typed_ast_copier::copy(const binary_expression &ref) {
+  auto &copy = m_container.make_node<binary_expression>(
+      ref.op_type(), copy_expr(ref.left()), copy_expr(ref.right()), ref.loc()
+  );
+  copy.type = ref.type;
+  return copy;
+}
+
+unary_expression &typed_ast_copier::copy(const unary_expression &ref) {
+  auto &copy = m_container.make_node<unary_expression>(
+      ref.op_type(), copy_expr(ref.expr()), ref.loc()
+  );
+  copy.type = ref.type;
+  return copy;
+}
+
+assignment_statement &typed_ast_copier::copy(const assignment_statement &ref) {
+  using left_type = std::variant<variable_expression, subscript>;
+  auto copy_left = [this](auto &&left) {
+    return std::visit([this](auto &&var) -> left_type { return copy(var); }, left);
+  };
+
+  auto &copy = m_container.make_node<assignment_statement>(
+      copy_left(*ref.rbegin()), copy_expr(ref.right()), ref.loc()
+  );
+  for (auto start = std::next(ref.rbegin()), finish = ref.rend(); start != finish; ++start) {
+    std::visit([&copy](auto &&var) { copy.append(var); }, copy_left(*start));
+  }
+
+  copy.type = ref.type;
+  return copy;
+}
+
+print_statement &typed_ast_copier::copy(const print_statement &ref) {
+  return m_container.make_node<print_statement>(copy_expr(ref.expr()), ref.loc());
+}
+
+return_statement &typed_ast_copier::copy(const return_statement &ref) {
+  auto *expr = (ref.empty() ? nullptr : &copy_expr(ref.expr()));
+  return m_container.make_node<return_statement>(expr, ref.loc());
+}
+
+if_statement &typed_ast_copier::copy(const if_statement &ref) {
+  auto &cond = copy_expr(*ref.cond());
+  auto &true_block = copy(*ref.true_block());
+  auto *else_block = (ref.else_block() ? &copy(*ref.else_block()) : nullptr);
+
+  auto &result = [&]() -> if_statement & {
+    if (!else_block) return m_container.make_node<if_statement>(cond, true_block, ref.loc());
+    return m_container.make_node<if_statement>(cond, true_block, *else_block, ref.loc());
+  }();
+
+  result.control_block_symtab = rename(ref.control_block_symtab);
+  result.true_symtab = rename(ref.true_symtab);
+  result.false_symtab = rename(ref.false_symtab);
+  return result;
+}
+
+while_statement &typed_ast_copier::copy(const while_statement &ref) {
+  auto &cond = copy_expr(*ref.cond());
+  auto &block = copy(*ref.block());
+  auto &result = m_container.make_node<while_statement>(cond, block, ref.loc());
+  result.symbol_table = rename(ref.symbol_table);
+  return result;
+}
+
+function_call &typed_ast_copier::copy(const function_call &ref) {
+  auto &copy = m_container.make_node<function_call>(rename(ref.name()), ref.loc());
+  for (const auto *arg : ref) {
+    assert(arg);
+    copy.append_parameter(&copy_expr(*arg));
+  }
+
+  copy.m_def = ref.m_def;
+  copy.m_tail_call = ref.m_tail_call;
+  copy.type = ref.type;
+  return copy;
+}
+
+function_definition_to_ptr_conv &
+typed_ast_copier::copy(const function_definition_to_ptr_conv &ref) {
+  auto &copy =
+      m_container.make_node<function_definition_to_ptr_conv>(ref.definition(), ref.loc());
+  copy.type = ref.type;
+  return copy;
+}
+
+// Definitions don't generate any code where they appear, both copies can refer to the same one.
+i_ast_node &typed_ast_copier::copy(const function_definition &ref) {
+  return const_cast<function_definition &>(ref);
+}
+
+i_ast_node &typed_ast_copier::copy(const i_ast_node &) {
+  throw std::logic_error{"Attempt to copy an unsupported node"};
+}
+
+function_definition &
+clone_function(const function_definition &def, std::string name, ast_container &container) {
+  const typed_ast_copier::rename_map names;
+  typed_ast_copier copier = {container, names};
+  auto &body = copier.apply(def.body());
+
+  std::vector<variable_expression> params{def.begin(), def.end()};
+  return container.make_node<function_definition>(
+      std::move(name), body, def.loc(), std::move(params), def.type.return_type()
+  );
+}
+
+} // namespace paracl::frontend::ast
@@ -1,13 +1,25 @@
 #include "llvm_codegen/codegen.hpp"
+#include "llvm_codegen/runtime.hpp"
 #include "ezvis/ezvis.hpp"
 #include "frontend/analysis/function_explorer.hpp"
+#include "frontend/analysis/purity_analyzer.hpp"
 #include "frontend/ast/ast_nodes/function_decl.hpp"
 #include "frontend/ast/ast_nodes/subscript.hpp"
 #include "frontend/ast/ast_nodes/variable_expression.hpp"
 #include "frontend/types/types.hpp"
+#include "utils/transparent.hpp"
 
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/IRBuilder.h>
-
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <optional>
 #include <ranges>
 #include <stdexcept>
 #include <variant>
@@ -40,35 +52,25 @@ public:
   using vector::begin;
   using vector::empty;
   using vector::end;
+  using vector::rend;
   using vector::size;
 
   void begin_scope() { vector::emplace_back(); }
-  void end_scope() { vector::emplace_back(); }
+  void end_scope() { vector::pop_back(); }
 
   void add(std::string_view name, symbol value) { vector::back().add(name, value); }
 
   auto lookup(std::string_view name) -> std::optional<symbol> {
-    auto found = ranges::find_if(*this, [name](auto &scope) -> bool {
+    auto found = ranges::find_if(std::views::reverse(*this), [name](auto &scope) -> bool {
       return scope.lookup(name).has_value();
     });
-    if (found == end()) return std::nullopt;
+    if (found == rend()) return std::nullopt;
     return found->lookup(name).value();
   }
 };
 
 namespace intrinsics {
 
-void print(int32_t val) {
-  fmt::println("{}", val);
-}
-
-int32_t read() {
-  int32_t v;
-  std::cin >> v;
-  if (!std::cin.good()) throw std::runtime_error("Invalid read");
-  return v;
-}
-
 namespace {
 auto get_intrinsic_function(std::string_view name, Module &m, Type *ret, ArrayRef<Type *> args = {})
     -> Function * {
@@ -76,10 +78,116 @@ auto get_intrinsic_function(std::string_view name, Module &m, Type *ret, ArrayRe
   auto *func_type = FunctionType::get(ret, args, false);
   return Function::Create(func_type, Function::ExternalLinkage, name, &m);
 }
+
+auto get_internal_global(std::string_view name, Module &m, Type *type) -> GlobalVariable * {
+  if (auto *ptr = m.getGlobalVariable(name, true)) return ptr;
+  return new GlobalVariable(
+      m, type, false, GlobalValue::InternalLinkage, Constant::getNullValue(type), name
+  );
+}
 } // namespace
+
+// Contents and size of the output buffer of the module, see __attach_output.
+auto get_output_buffer(Module &m) -> std::pair<GlobalVariable *, GlobalVariable *> {
+  auto &ctx = m.getContext();
+  auto *data_type = ArrayType::get(Type::getInt8Ty(ctx), runtime::output_buffer_size);
+  return {
+      get_internal_global("__pcl_output", m, data_type),
+      get_internal_global("__pcl_output_size", m, Type::getInt32Ty(ctx))};
+}
+
+auto get_attach_output_function(Module &m) -> Function * {
+  auto &ctx = m.getContext();
+  auto *ptr = Type::getInt8PtrTy(ctx);
+  return get_intrinsic_function(
+      "__attach_output", m, Type::getVoidTy(ctx), {ptr, Type::getInt32PtrTy(ctx)}
+  );
+}
+
+auto get_flush_output_function(Module &m) -> Function * {
+  return get_intrinsic_function("__flush_output", m, Type::getVoidTy(m.getContext()));
+}
+
+// Print is defined in every module, so that LLVM can inline it down to the formatting of the number
+// into the output buffer. The runtime is only called when the buffer is full.
 auto get_print_function(Module &m) -> Function * {
+  if (auto *ptr = m.getFunction("__print")) return ptr;
   auto &ctx = m.getContext();
-  return get_intrinsic_function("__print", m, Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)});
+  auto *i32 = Type::getInt32Ty(ctx);
+  auto *func_type = FunctionType::get(Type::getVoidTy(ctx), {i32}, false);
+  auto *func = Function::Create(func_type, Function::InternalLinkage, "__print", &m);
+  func->addFnAttr(Attribute::InlineHint);
+  func->addFnAttr(Attribute::NoUnwind);
+
+  auto [data, size] = get_output_buffer(m);
+  auto *data_type = data->getValueType();
+  auto *entry = BasicBlock::Create(ctx, "entry", func);
+  auto *flush = BasicBlock::Create(ctx, "flush", func);
+  auto *format = BasicBlock::Create(ctx, "format", func);
+  auto *count = BasicBlock::Create(ctx, "count", func);
+  auto *digits = BasicBlock::Create(ctx, "digits", func);
+  auto *done = BasicBlock::Create(ctx, "done", func);
+
+  IRBuilder<> builder{entry};
+  auto char_at = [&](Value *pos) {
+    auto *index = builder.CreateZExt(pos, Type::getInt64Ty(ctx));
+    return builder.CreateInBoundsGEP(data_type, data, {builder.getInt64(0), index});
+  };
+
+  auto *start_size = builder.CreateLoad(i32, size);
+  const auto limit = runtime::output_buffer_size - runtime::max_print_length;
+  builder.CreateCondBr(builder.CreateICmpUGT(start_size, builder.getInt32(limit)), flush, format);
+
+  builder.SetInsertPoint(flush);
+  builder.CreateCall(get_flush_output_function(m));
+  builder.CreateBr(format);
+
+  // The magnitude is unsigned, so that the minimal int works too.
+  builder.SetInsertPoint(format);
+  auto *pos = builder.CreatePHI(i32, 2);
+  pos->addIncoming(start_size, entry);
+  pos->addIncoming(builder.getInt32(0), flush);
+  auto *val = func->getArg(0);
+  auto *negative = builder.CreateICmpSLT(val, builder.getInt32(0));
+  auto *magnitude = builder.CreateSelect(negative, builder.CreateNeg(val), val);
+  builder.CreateBr(count);
+
+  builder.SetInsertPoint(count);
+  auto *length = builder.CreatePHI(i32, 2);
+  auto *rest = builder.CreatePHI(i32, 2);
+  length->addIncoming(builder.getInt32(1), format);
+  rest->addIncoming(magnitude, format);
+  length->addIncoming(builder.CreateAdd(length, builder.getInt32(1)), count);
+  rest->addIncoming(builder.CreateUDiv(rest, builder.getInt32(10)), count);
+  auto *more = builder.CreateICmpUGE(rest, builder.getInt32(10));
+  auto *counted = BasicBlock::Create(ctx, "counted", func, digits);
+  builder.CreateCondBr(more, count, counted);
+
+  // The sign is always written, without one the first digit goes over it.
+  builder.SetInsertPoint(counted);
+  builder.CreateStore(builder.getInt8('-'), char_at(pos));
+  auto *end = builder.CreateAdd(builder.CreateAdd(pos, builder.CreateZExt(negative, i32)), length);
+  builder.CreateBr(digits);
+
+  builder.SetInsertPoint(digits);
+  auto *digit_pos = builder.CreatePHI(i32, 2);
+  auto *digit_rest = builder.CreatePHI(i32, 2);
+  digit_pos->addIncoming(end, counted);
+  digit_rest->addIncoming(magnitude, counted);
+  auto *next_pos = builder.CreateSub(digit_pos, builder.getInt32(1));
+  auto *next_rest = builder.CreateUDiv(digit_rest, builder.getInt32(10));
+  auto *digit = builder.CreateSub(digit_rest, builder.CreateMul(next_rest, builder.getInt32(10)));
+  auto *digit_char = builder.CreateAdd(digit, builder.getInt32('0'));
+  builder.CreateStore(builder.CreateTrunc(digit_char, builder.getInt8Ty()), char_at(next_pos));
+  digit_pos->addIncoming(next_pos, digits);
+  digit_rest->addIncoming(next_rest, digits);
+  builder.CreateCondBr(builder.CreateICmpEQ(next_rest, builder.getInt32(0)), done, digits);
+
+  builder.SetInsertPoint(done);
+  builder.CreateStore(builder.getInt8('\n'), char_at(end));
+  builder.CreateStore(builder.CreateAdd(end, builder.getInt32(1)), size);
+  builder.CreateRetVoid();
+  return func;
 }
 
 auto get_read_function(Module &m) -> Function * {
@@ -87,6 +195,28 @@ auto get_read_function(Module &m) -> Function * {
   return get_intrinsic_function("__read", m, Type::getInt32Ty(ctx));
 }
 
+auto get_bounds_error_function(Module &m) -> Function * {
+  auto &ctx = m.getContext();
+  auto *i32 = Type::getInt32Ty(ctx);
+  auto *func = get_intrinsic_function("__bounds_error", m, Type::getVoidTy(ctx), {i32, i32});
+  func->setDoesNotReturn();
+  return func;
+}
+
+auto get_memo_lookup_function(Module &m) -> Function * {
+  auto &ctx = m.getContext();
+  auto *i32 = Type::getInt32Ty(ctx);
+  auto *ptr = Type::getInt32PtrTy(ctx);
+  return get_intrinsic_function("__memo_lookup", m, i32, {i32, ptr, i32, ptr});
+}
+
+auto get_memo_store_function(Module &m) -> Function * {
+  auto &ctx = m.getContext();
+  auto *i32 = Type::getInt32Ty(ctx);
+  auto *ptr = Type::getInt32PtrTy(ctx);
+  return get_intrinsic_function("__memo_store", m, Type::getVoidTy(ctx), {i32, ptr, i32, i32});
+}
+
 // auto get_print_function(Module &m) -> Function * {
 //   auto &ctx = m.getContext();
 //   return get_intrinsic_function("__print", m, Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)});
@@ -94,6 +224,79 @@ auto get_read_function(Module &m) -> Function * {
 } // namespace intrinsics
 
 namespace ast = frontend::ast;
+
+namespace {
+// Names that appear in a function body. Top-level variables that no function mentions are only
+// used by main and live on its stack, where LLVM can keep them in registers.
+class name_collector final
+    : public ezvis::visitor_base<const ast::i_ast_node, name_collector, void> {
+public:
+  utils::transparent::string_unordered_set names;
+
+private:
+  template <typename t_block> void collect_block(const t_block &ref) {
+    for (const auto *st : ref) {
+      assert(st);
+      apply(*st);
+    }
+  }
+
+public:
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  void collect(const ast::statement_block &ref) { collect_block(ref); }
+  void collect(const ast::value_block &ref) { collect_block(ref); }
+
+  void collect(const ast::if_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.true_block());
+    if (ref.else_block()) apply(*ref.else_block());
+  }
+
+  void collect(const ast::while_statement &ref) {
+    apply(*ref.cond());
+    apply(*ref.block());
+  }
+
+  void collect(const ast::assignment_statement &ref) {
+    for (const auto &left : ref) {
+      std::visit([this](auto &&var) { apply(var); }, left);
+    }
+    apply(ref.right());
+  }
+
+  void collect(const ast::binary_expression &ref) {
+    apply(ref.left());
+    apply(ref.right());
+  }
+
+  void collect(const ast::function_call &ref) {
+    if (!ref.get_callee()) names.emplace(ref.name()); // Called through a variable
+    for (const auto *arg : ref) {
+      assert(arg);
+      apply(*arg);
+    }
+  }
+
+  void collect(const ast::subscript &ref) {
+    names.emplace(ref.name());
+    apply(*ref.get_subscript());
+  }
+
+  void collect(const ast::print_statement &ref) { apply(ref.expr()); }
+  void collect(const ast::unary_expression &ref) { apply(ref.expr()); }
+  void collect(const ast::variable_expression &ref) { names.emplace(ref.name()); }
+
+  void collect(const ast::return_statement &ref) {
+    if (!ref.empty()) apply(ref.expr());
+  }
+
+  // Nested definitions are collected on their own.
+  void collect(const ast::i_ast_node &) {}
+
+  EZVIS_VISIT_INVOKER(collect);
+};
+} // namespace
 class codegen_visitor final
     : public ezvis::visitor_base<const ast::i_ast_node, codegen_visitor, llvm::Value *> {
   std::unique_ptr<Module> m;
@@ -103,20 +306,49 @@ class codegen_visitor final
   symtab sym;
   Function *current_function = nullptr;
   Function *entry = nullptr;
+  const ast::function_definition *current_definition = nullptr;
+
+  // The value block left by return statements. Returns in the body of a function leave the
+  // function instead, such a target has no exit block.
+  struct return_target {
+    Value *result = nullptr; // Null when the block has no value
+    BasicBlock *exit = nullptr;
+  };
+
+  return_target *current_return = nullptr;
+
+  // Arguments of the current memoized function, spilled to memory for the runtime.
+  struct memo_frame {
+    Value *args;
+    Value *id;
+    Value *n_args;
+  };
+
+  codegen_options options;
+  std::optional<memo_frame> current_memo;
+  unsigned memoized_count = 0;
+
+  // Line tables, only with codegen_options::debug_info.
+  std::unique_ptr<DIBuilder> dib;
+  DIFile *di_file = nullptr;
+  DISubroutineType *di_function_type = nullptr;
 
 public:
   using to_visit = std::tuple<
       ast::assignment_statement, ast::binary_expression, ast::constant_expression,
       ast::print_statement, ast::read_expression, ast::statement_block, ast::unary_expression,
       ast::variable_expression, ast::return_statement, ast::function_call, ast::if_statement,
-      ast::while_statement, ast::function_definition_to_ptr_conv, ast::subscript>;
+      ast::while_statement, ast::function_definition_to_ptr_conv, ast::subscript, ast::value_block>;
 
   EZVIS_VISIT_CT(to_visit)
 
   codegen_visitor(
-      std::string_view module_name, LLVMContext &ctx, const frontend::frontend_driver &drv
+      std::string_view module_name, LLVMContext &ctx, const frontend::frontend_driver &drv,
+      const codegen_options &opts
   )
-      : m(std::make_unique<Module>(module_name, ctx)), builder(ctx), fun_analysis(drv.functions()) {
+      : m(std::make_unique<Module>(module_name, ctx)), builder(ctx), fun_analysis(drv.functions()),
+        options(opts) {
+    if (options.debug_info) begin_debug_info(module_name);
   }
 
   Value *generate(const ast::binary_expression &);
@@ -135,12 +367,82 @@ public:
   Value *generate(const ast::while_statement &);
 
   Value *generate(const ast::statement_block &, bool global = false);
+  Value *generate(const ast::value_block &);
 
   EZVIS_VISIT_INVOKER(generate);
 
   auto &get_ctx() { return m->getContext(); }
 
-  auto emit_module() { return std::move(m); }
+  auto emit_module() {
+    if (dib) dib->finalize();
+    return std::move(m);
+  }
+
+  // ParaCL has no types in the debugger yet, functions are described by their lines only.
+  void begin_debug_info(std::string_view filename) {
+    auto path = std::filesystem::absolute(filename);
+    dib = std::make_unique<DIBuilder>(*m);
+    di_file = dib->createFile(path.filename().string(), path.parent_path().string());
+    dib->createCompileUnit(dwarf::DW_LANG_C, di_file, "pclc", false, "", 0);
+    di_function_type = dib->createSubroutineType(dib->getOrCreateTypeArray({}));
+    m->addModuleFlag(Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
+    m->addModuleFlag(Module::Warning, "Dwarf Version", 4);
+  }
+
+  void add_subprogram(Function &func, unsigned line) {
+    if (!dib) return;
+    auto flags = DISubprogram::SPFlagDefinition;
+    if (func.hasLocalLinkage()) flags |= DISubprogram::SPFlagLocalToUnit;
+    auto name = func.getName();
+    name.consume_front(symbol_prefix);
+    func.setSubprogram(dib->createFunction(
+        di_file, name, func.getName(), di_file, line, di_function_type, line,
+        DINode::FlagPrototyped, flags
+    ));
+  }
+
+  // Instructions generated next belong to this line of the current function.
+  void set_location(unsigned line, unsigned column) {
+    if (!dib) return;
+    auto *scope = current_function->getSubprogram();
+    builder.SetCurrentDebugLocation(DILocation::get(get_ctx(), line, column, scope));
+  }
+
+  void set_location(const ast::i_ast_node &ref) {
+    auto pos = ref.loc().begin;
+    set_location(pos.line, pos.column);
+  }
+
+  // Allocas go to the entry block of the function, so that loops don't grow the stack and mem2reg
+  // can promote them. The variable is zeroed where its scope begins.
+  Value *create_local(const ast::variable_expression &def) {
+    assert(current_function);
+    auto &entry_block = current_function->getEntryBlock();
+    IRBuilder<> entry_builder{&entry_block, entry_block.begin()};
+    auto *type = to_storage_type(def.type);
+    auto *local = entry_builder.CreateAlloca(type, nullptr, def.name());
+
+    if (def.type.base().get_class() != frontend::types::type_class::E_ARRAY) {
+      builder.CreateStore(Constant::getNullValue(type), local);
+      return local;
+    }
+
+    auto &array_type = static_cast<const frontend::types::type_array &>(def.type.base());
+    builder.CreateMemSet(
+        local, Constant::getIntegerValue(Type::getInt8Ty(get_ctx()), APInt(8, 0)),
+        array_type.size * 4, MaybeAlign()
+    );
+    return local;
+  }
+
+  // Unnamed zeroed local, see create_local.
+  Value *create_temporary(Type *type, const Twine &name) {
+    auto &entry_block = current_function->getEntryBlock();
+    IRBuilder<> entry_builder{&entry_block, entry_block.begin()};
+    auto *local = entry_builder.CreateAlloca(type, nullptr, name);
+    builder.CreateStore(Constant::getNullValue(type), local);
+    return local;
+  }
 
   void begin_scope(const frontend::symtab &stab) {
     sym.begin_scope();
@@ -148,40 +450,23 @@ public:
     for (auto &[name, attrs] : stab) {
       auto *variable_def = attrs.m_definition;
       assert(variable_def);
-      auto *value = [&] {
-        auto &ref = *variable_def;
-        auto &type = ref.type.base();
-        if (variable_def->type && type.get_class() == frontend::types::type_class::E_ARRAY) {
-          auto &array_type =
-              static_cast<const frontend::types::type_array &>(variable_def->type.base());
-          auto *arr = builder.CreateAlloca(
-              to_llvm_type(array_type.element_type.base()),
-              Constant::getIntegerValue(Type::getInt32Ty(get_ctx()), APInt(32, array_type.size))
-          );
-          builder.CreateMemSet(
-              arr, Constant::getIntegerValue(Type::getInt8Ty(get_ctx()), APInt(8, 0)),
-              array_type.size * 4, MaybeAlign()
-          );
-          return arr;
-        } else
-          return builder.CreateAlloca(
-              to_llvm_type(variable_def->type), 0, nullptr, variable_def->name()
-          );
-      }();
-      sym.add(name, {value, variable_def});
+      sym.add(name, {create_local(*variable_def), variable_def});
     }
   }
 
+  // Type of the memory that holds a variable.
+  Type *to_storage_type(const frontend::types::generic_type &type) {
+    if (type.base().get_class() != frontend::types::type_class::E_ARRAY) return to_llvm_type(type);
+    auto &array_type = static_cast<const frontend::types::type_array &>(type.base());
+    return ArrayType::get(to_llvm_type(array_type.element_type), array_type.size);
+  }
+
   Type *to_llvm_type(const frontend::types::i_type &type) {
     using namespace frontend::types;
     return ezvis::visit<Type *, type_composite_function, type_builtin>(
         utils::visitors{
-            [this](const type_composite_function &func) {
-              auto *return_type = to_llvm_type(func.return_type());
-              auto args_types = std::views::all(func) |
-                  ranges::views::transform([this](auto &type) { return to_llvm_type(type); }) |
-                  ranges::to<std::vector>();
-              return FunctionType::get(return_type, args_types, false);
+            [this](const type_composite_function &func) -> Type * {
+              return PointerType::getUnqual(to_function_type(func));
             },
             [this](const type_array &arr) { throw std::runtime_error("Array type encountered"); },
             [this](const type_builtin &type) -> Type * {
@@ -198,64 +483,224 @@ public:
     );
   }
 
+  // Values of function types are pointers, see to_llvm_type.
+  FunctionType *to_function_type(const frontend::types::type_composite_function &func) {
+    auto *result_type = to_llvm_type(func.return_type());
+    auto args_types = std::views::all(func) |
+        ranges::views::transform([this](auto &type) { return to_llvm_type(type); }) |
+        ranges::to<std::vector>();
+    return FunctionType::get(result_type, args_types, false);
+  }
+
   void declare_functions(const frontend::functions_analytics &functions) {
     for (auto &&[key, attr] : functions.usegraph) {
       auto &&[name, func] = attr.value;
-      auto *func_type = to_llvm_type(func->type);
+      if (!functions.named_functions.lookup(name)) continue; // Eliminated as unreachable
+      // Only main is called from the outside, so the inliner and IPO passes may change the rest.
       auto *llvm_func = Function::Create(
-          static_cast<FunctionType *>(func_type), Function::ExternalLinkage, 0, func->name.value(),
+          to_function_type(func->type), Function::InternalLinkage, 0, Twine{symbol_prefix} + name,
           m.get()
       );
+      llvm_func->setCallingConv(CallingConv::Fast);
       funcs.try_emplace(func, llvm_func);
+      add_subprogram(*llvm_func, func->loc().begin.line);
+
+      // Lets LLVM keep globals in registers across the calls. Memoized functions write the cache.
+      if (functions.named_functions.lookup(name)->pure && !options.memoize) {
+        llvm_func->setDoesNotAccessMemory();
+        llvm_func->setDoesNotThrow();
+      }
+
+      auto count = options.profile ? options.profile->function(to_position(*func)) : std::nullopt;
+      if (count) llvm_func->setEntryCount(*count);
     }
     auto *entry_type = FunctionType::get(Type::getVoidTy(get_ctx()), false);
     entry = Function::Create(entry_type, Function::ExternalLinkage, 0, "main", m.get());
+    if (options.profile) entry->setEntryCount(1);
+    add_subprogram(*entry, 1);
+  }
+
+  static utils::source_position to_position(const ast::i_ast_node &ref) {
+    auto pos = ref.loc().begin;
+    return {pos.line, pos.column};
+  }
+
+  // Weights of the condition of an `if` or a `while` in the profiled run. Conditions that weren't
+  // evaluated are left alone, their block is cold by the entry count already.
+  void add_branch_weights(BranchInst &branch, const ast::i_ast_node &ref) {
+    auto counts = options.profile ? options.profile->branch(to_position(ref)) : std::nullopt;
+    if (!counts || (!counts->true_count && !counts->false_count)) return;
+
+    constexpr std::uint64_t max_weight = std::numeric_limits<std::uint32_t>::max();
+    auto scale = std::max(counts->true_count, counts->false_count) / max_weight + 1;
+    auto *weights = MDBuilder(get_ctx()).createBranchWeights(
+        counts->true_count / scale, counts->false_count / scale
+    );
+    branch.setMetadata(LLVMContext::MD_prof, weights);
+  }
+
+  // Without a summary the passes can't tell hot code from cold, see ProfileSummaryInfo. Branches
+  // go with main, as they aren't attributed to functions.
+  void add_profile_summary(const utils::execution_profile &profile) {
+    InstrProfSummaryBuilder summary{ProfileSummaryBuilder::DefaultCutoffs.vec()};
+    std::vector<std::uint64_t> main_counts = {1};
+    for (auto &&[pos, counts] : profile.branches()) {
+      main_counts.push_back(counts.true_count);
+      main_counts.push_back(counts.false_count);
+    }
+    summary.addRecord(InstrProfRecord{std::move(main_counts)});
+    for (auto &&[pos, count] : profile.functions()) {
+      summary.addRecord(InstrProfRecord{{count}});
+    }
+
+    m->setProfileSummary(summary.getSummary()->getMD(get_ctx()), ProfileSummary::PSK_Instr);
   }
 
-  void declare_globals(const frontend::ast::ast_container &ast) {
+  // Top-level variables used by functions become LLVM globals, the rest are allocas of main.
+  void declare_globals(const frontend::functions_analytics &functions) {
     auto *stab = fun_analysis.global_stab;
     assert(sym.empty());
     sym.begin_scope();
+
+    current_function = entry;
+    auto *entry_block = BasicBlock::Create(get_ctx(), "", entry);
+    builder.SetInsertPoint(entry_block);
+    set_location(1, 1);
+    auto [output, output_size] = intrinsics::get_output_buffer(*m);
+    builder.CreateCall(
+        intrinsics::get_attach_output_function(*m),
+        {builder.CreateConstInBoundsGEP2_32(output->getValueType(), output, 0, 0), output_size}
+    );
     if (!stab) return;
-    for (auto &&[name, attrs] : *fun_analysis.global_stab) {
+
+    name_collector shared;
+    for (auto &&[key, attr] : functions.usegraph) {
+      auto &&[name, func] = attr.value;
+      if (funcs.contains(func)) shared.apply(func->body());
+    }
+
+    for (auto &&[name, attrs] : *stab) {
       auto *def = attrs.m_definition;
       assert(def);
-      auto *type = to_llvm_type(def->type);
-      auto *global = static_cast<GlobalVariable *>(m->getOrInsertGlobal(name, type));
-      global->setInitializer(Constant::getNullValue(type));
-      sym.add(name, {global, nullptr});
+      if (!shared.names.contains(name)) {
+        sym.add(name, {create_local(*def), def});
+        continue;
+      }
+
+      // Internal like the functions, so they can't take over symbols of the runtime or libc.
+      auto *type = to_storage_type(def->type);
+      auto *global = new GlobalVariable(
+          *m, type, false, GlobalValue::InternalLinkage, Constant::getNullValue(type),
+          Twine{symbol_prefix} + name
+      );
+      sym.add(name, {global, def});
     }
   }
 
-  auto generate_function(const frontend::ast::function_definition &func) {
+  // Unsigned comparison also catches negative indices. See bounds_check_eliminator for the
+  // subscripts that skip it.
+  void generate_bounds_check(Value *index, std::size_t size) {
+    auto *size_value = builder.getInt32(size);
+    auto *fail = BasicBlock::Create(get_ctx(), "bounds.fail", current_function);
+    auto *ok = BasicBlock::Create(get_ctx(), "bounds.ok", current_function);
+    builder.CreateCondBr(builder.CreateICmpULT(index, size_value), ok, fail);
+
+    builder.SetInsertPoint(fail);
+    builder.CreateCall(intrinsics::get_bounds_error_function(*m), {index, size_value});
+    builder.CreateUnreachable();
+    builder.SetInsertPoint(ok);
+  }
+
+  // Returns the cached result right away on a hit. Every `return` stores its value, see
+  // generate(return_statement).
+  void generate_memo_lookup(Function &function) {
+    auto *i32 = Type::getInt32Ty(get_ctx());
+    auto n_args = function.arg_size();
+
+    auto *args = builder.CreateAlloca(i32, builder.getInt32(n_args), "memo.args");
+    for (auto &arg : function.args()) {
+      builder.CreateStore(&arg, builder.CreateConstGEP1_32(i32, args, arg.getArgNo()));
+    }
+
+    current_memo = memo_frame{args, builder.getInt32(memoized_count++), builder.getInt32(n_args)};
+
+    auto *result = builder.CreateAlloca(i32, nullptr, "memo.result");
+    auto *found = builder.CreateCall(
+        intrinsics::get_memo_lookup_function(*m),
+        {current_memo->id, current_memo->args, current_memo->n_args, result}
+    );
+
+    auto *hit = BasicBlock::Create(get_ctx(), "memo.hit", &function);
+    auto *miss = BasicBlock::Create(get_ctx(), "memo.miss", &function);
+    builder.CreateCondBr(builder.CreateICmpNE(found, builder.getInt32(0)), hit, miss);
+
+    builder.SetInsertPoint(hit);
+    builder.CreateRet(builder.CreateLoad(i32, result));
+    builder.SetInsertPoint(miss);
+  }
 
+  auto generate_function(const frontend::ast::function_definition &func, bool memoized) {
     auto *function = this->funcs.at(&func);
     current_function = function;
+    current_definition = &func;
+    current_memo.reset();
     auto *entry_block = BasicBlock::Create(get_ctx(), "entry", function);
     builder.SetInsertPoint(entry_block);
+    set_location(func);
     begin_scope(func.param_stab);
 
     for (auto &&[arg_value, variable_expr] : llvm::zip(function->args(), func)) {
       builder.CreateStore(&arg_value, sym.lookup(variable_expr.name()).value().val);
     }
 
-    generate(
-        static_cast<const ast::statement_block &>(func.body()),
-        /*global_scope=*/false
-    );
+    if (memoized) generate_memo_lookup(*function);
 
+    apply(func.body());
     sym.end_scope();
-    if (func.type.return_type() == frontend::types::type_builtin::type_void)
-      builder.CreateRetVoid();
+    if (builder.GetInsertBlock()->getTerminator()) return;
+
+    // Falls through the end of the body without a value, like value blocks do
+    auto *result_type = function->getReturnType();
+    auto *zero = result_type->isVoidTy() ? nullptr : Constant::getNullValue(result_type);
+    generate_function_return(zero);
+  }
+
+  Value *generate_function_return(Value *val) {
+    if (current_function == entry) {
+      builder.CreateCall(intrinsics::get_flush_output_function(*m));
+      return builder.CreateRetVoid();
+    }
+    if (!val || current_function->getReturnType()->isVoidTy()) return builder.CreateRetVoid();
+
+    if (current_memo) {
+      builder.CreateCall(
+          intrinsics::get_memo_store_function(*m),
+          {current_memo->id, current_memo->args, current_memo->n_args, val}
+      );
+    }
+    return builder.CreateRet(val);
+  }
+
+  // Statements after a return are never executed and aren't generated.
+  template <typename t_block> void generate_statements(const t_block &block) {
+    for (auto *st : block) {
+      assert(st);
+      if (ast::identify_node(st) == ast::ast_node_type::E_FUNCTION_DEFINITION) continue;
+      set_location(*st);
+      apply(*st);
+      if (builder.GetInsertBlock()->getTerminator()) break;
+    }
   }
 
   void generate(const frontend::ast::ast_container &ast, const frontend::frontend_driver &drv) {
     declare_functions(drv.functions());
-    declare_globals(ast);
+    declare_globals(drv.functions());
     for (auto &&[_, attr] : drv.functions().usegraph) {
       auto &&[name, func] = attr.value;
       assert(func);
-      generate_function(*func);
+      if (!funcs.contains(func)) continue;
+      auto found = drv.functions().named_functions.lookup(name);
+      generate_function(*func, options.memoize && frontend::purity_analyzer::is_memoizable(*found));
     }
 
     if (ast.get_root_ptr()) {
@@ -263,12 +708,17 @@ public:
           [this](auto &st) { generate(st, /*global_scope=*/true); }, *ast.get_root_ptr()
       );
     }
+
+    if (options.profile) add_profile_summary(*options.profile);
   }
 };
 
 Value *codegen_visitor::generate(const ast::binary_expression &expr) {
   auto *lhs = apply(expr.left());
   auto *rhs = apply(expr.right());
+  auto *i32 = Type::getInt32Ty(get_ctx());
+  // Logical and comparison operators give 0 or 1, both operands are always evaluated
+  auto to_int = [&](Value *flag) { return builder.CreateZExt(flag, i32); };
   using namespace ast;
   switch (expr.op_type()) {
   case binary_operation::E_BIN_OP_ADD: return builder.CreateAdd(lhs, rhs);
@@ -276,15 +726,17 @@ Value *codegen_visitor::generate(const ast::binary_expression &expr) {
   case binary_operation::E_BIN_OP_MUL: return builder.CreateMul(lhs, rhs);
   case binary_operation::E_BIN_OP_DIV: return builder.CreateSDiv(lhs, rhs);
   case binary_operation::E_BIN_OP_MOD: return builder.CreateSRem(lhs, rhs);
-  case binary_operation::E_BIN_OP_AND: return builder.CreateAnd(lhs, rhs);
-  case binary_operation::E_BIN_OP_OR: return builder.CreateOr(lhs, rhs);
+  case binary_operation::E_BIN_OP_AND:
+    return to_int(builder.CreateAnd(builder.CreateIsNotNull(lhs), builder.CreateIsNotNull(rhs)));
+  case binary_operation::E_BIN_OP_OR:
+    return to_int(builder.CreateOr(builder.CreateIsNotNull(lhs), builder.CreateIsNotNull(rhs)));
   // compare ops
-  case binary_operation::E_BIN_OP_EQ: return builder.CreateICmpEQ(lhs, rhs);
-  case binary_operation::E_BIN_OP_NE: return builder.CreateICmpNE(lhs, rhs);
-  case binary_operation::E_BIN_OP_GT: return builder.CreateICmpSGT(lhs, rhs);
-  case binary_operation::E_BIN_OP_LS: return builder.CreateICmpSLT(lhs, rhs);
-  case binary_operation::E_BIN_OP_GE: return builder.CreateICmpSGE(lhs, rhs);
-  case binary_operation::E_BIN_OP_LE: return builder.CreateICmpSLE(lhs, rhs);
+  case binary_operation::E_BIN_OP_EQ: return to_int(builder.CreateICmpEQ(lhs, rhs));
+  case binary_operation::E_BIN_OP_NE: return to_int(builder.CreateICmpNE(lhs, rhs));
+  case binary_operation::E_BIN_OP_GT: return to_int(builder.CreateICmpSGT(lhs, rhs));
+  case binary_operation::E_BIN_OP_LS: return to_int(builder.CreateICmpSLT(lhs, rhs));
+  case binary_operation::E_BIN_OP_GE: return to_int(builder.CreateICmpSGE(lhs, rhs));
+  case binary_operation::E_BIN_OP_LE: return to_int(builder.CreateICmpSLE(lhs, rhs));
   default: throw std::invalid_argument("Unknown binary operation");
   }
 }
@@ -296,7 +748,7 @@ Value *codegen_visitor::generate(const ast::unary_expression &expr) {
   switch (expr.op_type()) {
   case E_UN_OP_NEG: return builder.CreateNeg(val);
   case E_UN_OP_POS: return val;
-  case E_UN_OP_NOT: return builder.CreateNot(val);
+  case E_UN_OP_NOT: return builder.CreateZExt(builder.CreateIsNull(val), val->getType());
   default: throw std::invalid_argument("Unknown unary operation");
   }
 }
@@ -314,6 +766,7 @@ Value *codegen_visitor::generate(const ast::subscript &sub, bool do_load) {
   assert(var->type.base().get_class() == frontend::types::type_class::E_ARRAY);
   auto &arr_type = static_cast<const frontend::types::type_array &>(var->type.base());
   auto *elem_type = to_llvm_type(arr_type.element_type);
+  if (!sub.m_in_bounds) generate_bounds_check(subscript, arr_type.size);
   auto *elem = builder.CreateGEP(
       ArrayType::get(elem_type, arr_type.size), ptr,
       {Constant::getIntegerValue(Type::getInt32Ty(get_ctx()), APInt::getZero(32)), subscript}
@@ -326,9 +779,23 @@ Value *codegen_visitor::generate(const ast::constant_expression &expr) {
 }
 
 Value *codegen_visitor::generate(const ast::return_statement &ret) {
-  if (ret.empty()) return builder.CreateRetVoid();
-  auto *val = apply(ret.expr());
-  return builder.CreateRet(val);
+  auto *val = ret.empty() ? nullptr : apply(ret.expr());
+  if (current_return && current_return->exit) {
+    if (current_return->result && val) builder.CreateStore(val, current_return->result);
+    return builder.CreateBr(current_return->exit);
+  }
+
+  // The call is immediately returned, see tail_call_marker. With the same prototype the frame can
+  // always be reused, otherwise leave it up to the backend. Memoized functions store the result.
+  // Runtime calls like the one of `?` aren't function_call nodes.
+  auto *call = dyn_cast_or_null<CallInst>(val);
+  if (call && !current_memo && current_function != entry &&
+      ast::identify_node(ret.expr()) == ast::ast_node_type::E_FUNCTION_CALL &&
+      static_cast<const ast::function_call &>(ret.expr()).m_tail_call) {
+    const bool same_type = call->getFunctionType() == current_function->getFunctionType();
+    call->setTailCallKind(same_type ? CallInst::TCK_MustTail : CallInst::TCK_Tail);
+  }
+  return generate_function_return(val);
 }
 
 Value *codegen_visitor::generate(const ast::if_statement &stmt) {
@@ -338,12 +805,12 @@ Value *codegen_visitor::generate(const ast::if_statement &stmt) {
   auto *after_if = BasicBlock::Create(get_ctx(), "next", current_function);
   begin_scope(stmt.control_block_symtab);
   auto *condition = builder.CreateIsNotNull(apply(*stmt.cond()));
-  builder.CreateCondBr(condition, if_true, if_false ? if_false : after_if);
+  auto *branch = builder.CreateCondBr(condition, if_true, if_false ? if_false : after_if);
+  add_branch_weights(*branch, stmt);
   auto create_block = [&](const ast::i_ast_node &stblock, BasicBlock *block) {
     builder.SetInsertPoint(block);
     apply(stblock);
-    if (block->empty() || !(isa<BranchInst>(block->back()) || isa<ReturnInst>(block->back())))
-      builder.CreateBr(after_if);
+    if (!builder.GetInsertBlock()->getTerminator()) builder.CreateBr(after_if);
   };
   create_block(*stmt.true_block(), if_true);
   if (if_false) create_block(*stmt.else_block(), if_false);
@@ -362,11 +829,11 @@ Value *codegen_visitor::generate(const ast::while_statement &stmt) {
 
   builder.SetInsertPoint(cond);
   auto *condition = builder.CreateIsNotNull(apply(*stmt.cond()));
-  builder.CreateCondBr(condition, body, exit);
+  add_branch_weights(*builder.CreateCondBr(condition, body, exit), stmt);
 
   builder.SetInsertPoint(body);
   apply(*stmt.block());
-  builder.CreateBr(cond);
+  if (!builder.GetInsertBlock()->getTerminator()) builder.CreateBr(cond);
 
   sym.end_scope();
 
@@ -380,22 +847,45 @@ Value *codegen_visitor::generate(const ast::while_statement &stmt) {
 Value *codegen_visitor::generate(const ast::statement_block &stmt_block, bool global) {
   if (global) {
     current_function = entry;
-    auto *entry_block = BasicBlock::Create(get_ctx(), "", entry);
-    builder.SetInsertPoint(entry_block);
+    current_definition = nullptr;
+    builder.SetInsertPoint(&entry->getEntryBlock()); // After the allocas, see declare_globals
+    set_location(1, 1);
   } else {
     begin_scope(stmt_block.stab);
   }
 
-  for (auto *st : stmt_block) {
-    if (frontend::ast::identify_node(st) == ast::ast_node_type::E_FUNCTION_DEFINITION) continue;
-    if (frontend::ast::identify_node(st) == ast::ast_node_type::E_RETURN_STATEMENT) break;
-    apply(*st);
-  }
-  if (global) builder.CreateRetVoid();
+  generate_statements(stmt_block);
+  if (global && !builder.GetInsertBlock()->getTerminator()) generate_function_return(nullptr);
   sym.end_scope();
   return nullptr;
 }
 
+// Returns in a value block store the result and jump to its end, falling through the end gives 0.
+// The body of a function is the only block whose returns go back to the caller.
+Value *codegen_visitor::generate(const ast::value_block &block) {
+  const bool function_body = current_definition && &block == &current_definition->body();
+  auto *type = block.type && block.type != frontend::types::type_builtin::type_void
+                 ? to_llvm_type(block.type)
+                 : nullptr;
+
+  return_target target;
+  if (!function_body) {
+    target.exit = BasicBlock::Create(get_ctx(), "block.exit", current_function);
+    if (type) target.result = create_temporary(type, "block.result");
+  }
+
+  auto *prev_return = std::exchange(current_return, &target);
+  begin_scope(block.stab);
+  generate_statements(block);
+  sym.end_scope();
+  current_return = prev_return;
+  if (function_body) return nullptr;
+
+  if (!builder.GetInsertBlock()->getTerminator()) builder.CreateBr(target.exit);
+  builder.SetInsertPoint(target.exit);
+  return type ? builder.CreateLoad(type, target.result) : nullptr;
+}
+
 Value *codegen_visitor::generate(const ast::read_expression &read) {
   return builder.CreateCall(intrinsics::get_read_function(*m), {});
 }
@@ -433,14 +923,27 @@ Value *codegen_visitor::generate(const ast::assignment_statement &stmt) {
 Value *codegen_visitor::generate(const ast::function_call &call) {
   auto args = call | ranges::views::transform([this](auto &a) { return apply(*a); }) |
       ranges::to<std::vector>();
-  auto *callee = call.get_callee();
-  assert(callee);
-  return builder.CreateCall(funcs.at(callee), args);
+  if (auto *callee = call.get_callee()) {
+    auto *inst = builder.CreateCall(funcs.at(callee), args);
+    inst->setCallingConv(CallingConv::Fast);
+    return inst;
+  }
+
+  // Called through a variable that holds a pointer to one of the functions above
+  auto [ptr, var] = sym.lookup(call.name()).value();
+  assert(var && var->type.base().get_class() == frontend::types::type_class::E_COMPOSITE_FUNCTION);
+  auto &type = static_cast<const frontend::types::type_composite_function &>(var->type.base());
+  auto *func_type = to_function_type(type);
+  auto *callee = builder.CreateLoad(PointerType::getUnqual(func_type), ptr);
+  auto *inst = builder.CreateCall(func_type, callee, args);
+  inst->setCallingConv(CallingConv::Fast);
+  return inst;
 }
 
-auto emit_llvm(const frontend::frontend_driver &drv, LLVMContext &ctx)
-    -> std::unique_ptr<llvm::Module> {
-  codegen_visitor visitor(drv.get_filename(), ctx, drv);
+auto emit_llvm(
+    const frontend::frontend_driver &drv, LLVMContext &ctx, const codegen_options &options
+) -> std::unique_ptr<llvm::Module> {
+  codegen_visitor visitor(drv.get_filename(), ctx, drv, options);
   visitor.generate(drv.ast(), drv);
   return visitor.emit_module();
 }
@@ -0,0 +1,223 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "llvm_codegen/jit.hpp"
+#include "llvm_codegen/codegen.hpp"
+#include "llvm_codegen/partition.hpp"
+#include "llvm_codegen/runtime.hpp"
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/Core.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/Object/SymbolSize.h>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace paracl::llvm_codegen {
+
+namespace {
+namespace orc = llvm::orc;
+
+template <typename T> T unwrap(llvm::Expected<T> value) {
+  if (!value) throw std::runtime_error(llvm::toString(value.takeError()));
+  return std::move(*value);
+}
+
+void check(llvm::Error err) {
+  if (err) throw std::runtime_error(llvm::toString(std::move(err)));
+}
+
+template <typename T> std::optional<T> to_optional(llvm::Expected<T> value) {
+  if (value) return std::move(*value);
+  llvm::consumeError(value.takeError());
+  return std::nullopt;
+}
+
+// Appends the functions of every loaded object to /tmp/perf-<pid>.map, the text format perf falls
+// back to for code without a file. Works with any perf, unlike the jitdump listener of LLVM.
+class perf_map_listener final : public llvm::JITEventListener {
+  std::mutex m_mutex; // Objects are loaded by the compile threads
+  std::ofstream m_map;
+
+  // The lazy JIT renames internal functions to `__orc_lcl.<name>.<n>` when it splits the module.
+  // Both drop symbol_prefix, so that perf shows the names of the source.
+  static std::string source_name(llvm::StringRef name) {
+    if (name.consume_front("__orc_lcl.")) name = name.rsplit('.').first;
+    name.consume_front(symbol_prefix);
+    return name.str();
+  }
+
+public:
+  perf_map_listener() : m_map{fmt::format("/tmp/perf-{}.map", ::getpid())} {}
+
+  void notifyObjectLoaded(
+      ObjectKey, const llvm::object::ObjectFile &obj,
+      const llvm::RuntimeDyld::LoadedObjectInfo &info
+  ) override {
+    auto loaded = info.getObjectForDebug(obj); // Has the addresses the sections were loaded at
+    if (!loaded.getBinary()) return;
+
+    std::lock_guard lock{m_mutex};
+    for (auto &&[symbol, size] : llvm::object::computeSymbolSizes(*loaded.getBinary())) {
+      auto type = to_optional(symbol.getType());
+      if (!type || *type != llvm::object::SymbolRef::ST_Function) continue;
+      auto name = to_optional(symbol.getName());
+      auto address = to_optional(symbol.getAddress());
+      if (!name || !address || !size) continue;
+      m_map << fmt::format("{:x} {:x} {}\n", *address, size, source_name(*name));
+    }
+    m_map.flush();
+  }
+};
+
+// Defines the runtime functions called by the generated code as absolute symbols pointing into
+// this process, the first time the JIT looks them up.
+class runtime_generator final : public orc::DefinitionGenerator {
+  orc::SymbolMap m_symbols;
+
+  void add(orc::MangleAndInterner &mangle, std::string_view name, void *address) {
+    m_symbols.try_emplace(
+        mangle(name),
+        llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(address),
+            llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable
+        )
+    );
+  }
+
+public:
+  runtime_generator(orc::MangleAndInterner &mangle) {
+    add(mangle, "__attach_output", reinterpret_cast<void *>(__attach_output));
+    add(mangle, "__flush_output", reinterpret_cast<void *>(__flush_output));
+    add(mangle, "__read", reinterpret_cast<void *>(__read));
+    add(mangle, "__bounds_error", reinterpret_cast<void *>(__bounds_error));
+    add(mangle, "__memo_lookup", reinterpret_cast<void *>(__memo_lookup));
+    add(mangle, "__memo_store", reinterpret_cast<void *>(__memo_store));
+  }
+
+  llvm::Error tryToGenerate(
+      orc::LookupState &, orc::LookupKind, orc::JITDylib &jd, orc::JITDylibLookupFlags,
+      const orc::SymbolLookupSet &lookup_set
+  ) override {
+    orc::SymbolMap found;
+    for (auto &&[name, flags] : lookup_set) {
+      auto it = m_symbols.find(name);
+      if (it != m_symbols.end()) found.insert(*it);
+    }
+    if (found.empty()) return llvm::Error::success();
+    return jd.define(orc::absoluteSymbols(std::move(found)));
+  }
+};
+} // namespace
+
+void run_jit(
+    std::unique_ptr<llvm::Module> m, std::unique_ptr<llvm::LLVMContext> ctx,
+    const jit_options &options
+) {
+  auto jtmb = unwrap(orc::JITTargetMachineBuilder::detectHost()); // Host CPU and its features
+  jtmb.setCodeGenOptLevel(to_codegen_opt_level(options.opt_level));
+
+  auto tm = unwrap(jtmb.createTargetMachine());
+  optimize_for(*m, *tm, options.opt_level);
+  if (options.emit_llvm) m->dump();
+
+  auto threads = options.compile_threads;
+  if (!threads) threads = std::max(std::thread::hardware_concurrency(), 1u);
+  orc::LLLazyJITBuilder builder;
+  if (options.cache) {
+    options.cache->set_target(fmt::format(
+        "{} {} O{}", jtmb.getCPU(), jtmb.getFeatures().getString(), options.opt_level
+    ));
+    using compiler_ptr = std::unique_ptr<orc::IRCompileLayer::IRCompiler>;
+    builder.setCompileFunctionCreator(
+        [cache = options.cache](orc::JITTargetMachineBuilder tmb) -> llvm::Expected<compiler_ptr> {
+          return std::make_unique<orc::ConcurrentIRCompiler>(std::move(tmb), cache);
+        }
+    );
+  }
+
+  // Declared before the JIT, which notifies them until it is destroyed
+  using llvm::JITEventListener;
+  std::optional<perf_map_listener> perf_map;
+  std::vector<JITEventListener *> listeners;
+  if (options.perf_map) {
+    listeners.push_back(&perf_map.emplace());
+    auto *jitdump = JITEventListener::createPerfJITEventListener(); // Null without perf support
+    if (jitdump) listeners.push_back(jitdump);
+  }
+  if (options.debugger) listeners.push_back(JITEventListener::createGDBRegistrationListener());
+
+  if (!listeners.empty()) {
+    builder.setObjectLinkingLayerCreator(
+        [&listeners](orc::ExecutionSession &session, const llvm::Triple &)
+            -> llvm::Expected<std::unique_ptr<orc::ObjectLayer>> {
+          auto layer = std::make_unique<orc::RTDyldObjectLinkingLayer>(session, [] {
+            return std::make_unique<llvm::SectionMemoryManager>();
+          });
+          for (auto *listener : listeners) layer->registerJITEventListener(*listener);
+          return layer;
+        }
+    );
+  }
+
+  auto jit = unwrap(
+      builder.setJITTargetMachineBuilder(std::move(jtmb)).setNumCompileThreads(threads).create()
+  );
+
+  orc::MangleAndInterner mangle{jit->getExecutionSession(), jit->getDataLayout()};
+  auto &dylib = jit->getMainJITDylib();
+  dylib.addGenerator(std::make_unique<runtime_generator>(mangle));
+  // Calls that LLVM emits on its own, e.g. memset for zero-filled arrays, go to the C library
+  dylib.addGenerator(unwrap(orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      jit->getDataLayout().getGlobalPrefix()
+  )));
+
+  // A function compiled on its first call can't pass an error to its caller, the call would jump
+  // to a null address. Report it like the runtime errors and exit.
+  jit->getExecutionSession().setErrorReporter([](llvm::Error err) {
+    __flush_output();
+    fmt::println(stderr, "Error: {}", llvm::toString(std::move(err)));
+    std::_Exit(EXIT_FAILURE);
+  });
+
+  auto partitions = options.partitions ? options.partitions : partition_count(*m);
+  if (partitions > 1) {
+    // Eagerly added parts are materialized concurrently by the lookup of main
+    for (auto &part : split_module(*m, partitions)) check(jit->addIRModule(std::move(part)));
+  } else {
+    check(jit->addLazyIRModule(orc::ThreadSafeModule{std::move(m), std::move(ctx)}));
+  }
+
+  auto main_symbol = unwrap(jit->lookup("main"));
+  auto *entry = llvm::jitTargetAddressToFunction<void (*)()>(main_symbol.getAddress());
+  entry();
+}
+
+} // namespace paracl::llvm_codegen
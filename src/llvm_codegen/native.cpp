@@ -0,0 +1,151 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "llvm_codegen/native.hpp"
+#include "llvm_codegen/codegen.hpp"
+#include "llvm_codegen/partition.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace paracl::llvm_codegen {
+
+namespace {
+auto create_host_target_machine(unsigned opt_level) -> std::unique_ptr<llvm::TargetMachine> {
+  auto triple = llvm::sys::getDefaultTargetTriple();
+  std::string err;
+  const auto *target = llvm::TargetRegistry::lookupTarget(triple, err);
+  if (!target) throw std::runtime_error(err);
+
+  llvm::SubtargetFeatures features;
+  llvm::StringMap<bool> host_features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    for (auto &&feature : host_features)
+      features.AddFeature(feature.getKey(), feature.getValue());
+  }
+
+  return std::unique_ptr<llvm::TargetMachine>{target->createTargetMachine(
+      triple, llvm::sys::getHostCPUName(), features.getString(), llvm::TargetOptions{},
+      llvm::Reloc::PIC_, llvm::None, to_codegen_opt_level(opt_level)
+  )};
+}
+
+void write_object(llvm::Module &m, llvm::TargetMachine &tm, const std::filesystem::path &output) {
+  std::error_code ec;
+  llvm::raw_fd_ostream os{output.string(), ec, llvm::sys::fs::OF_None};
+  if (ec) throw std::runtime_error(fmt::format("Can't open {}: {}", output.string(), ec.message()));
+
+  llvm::legacy::PassManager pm;
+  if (tm.addPassesToEmitFile(pm, os, nullptr, llvm::CGFT_ObjectFile))
+    throw std::runtime_error("Target can't emit object files");
+  pm.run(m);
+}
+
+void optimize_native(llvm::Module &m, llvm::TargetMachine &tm, unsigned opt_level) {
+  auto *entry = m.getFunction("main");
+  if (!entry) throw std::runtime_error("Module has no main function");
+  entry->setName(native_entry_name);
+  optimize_for(m, tm, opt_level);
+}
+
+void link_executable(
+    const std::vector<std::string> &objects, const std::filesystem::path &output
+) {
+  auto linker = llvm::sys::findProgramByName(PARACL_LINKER);
+  if (!linker) throw std::runtime_error(fmt::format("Linker {} is not found", PARACL_LINKER));
+
+  auto output_str = output.string();
+  std::vector<llvm::StringRef> args = {*linker};
+  args.insert(args.end(), objects.begin(), objects.end());
+  args.insert(args.end(), {PARACL_RUNTIME_LIBRARY, "-o", output_str});
+  std::string err;
+  auto status = llvm::sys::ExecuteAndWait(*linker, args, llvm::None, {}, 0, 0, &err);
+  if (status != 0) {
+    throw std::runtime_error(fmt::format("Linking failed: {}", err.empty() ? "linker error" : err));
+  }
+}
+} // namespace
+
+void emit_object(llvm::Module &m, unsigned opt_level, const std::filesystem::path &output) {
+  auto tm = create_host_target_machine(opt_level);
+  optimize_native(m, *tm, opt_level);
+  write_object(m, *tm, output);
+}
+
+void emit_executable(
+    llvm::Module &m, unsigned opt_level, const std::filesystem::path &output, unsigned partitions
+) {
+  auto tm = create_host_target_machine(opt_level);
+  optimize_native(m, *tm, opt_level);
+  if (!partitions) partitions = partition_count(m);
+
+  std::vector<llvm::orc::ThreadSafeModule> parts;
+  if (partitions > 1) parts = split_module(m, partitions);
+
+  std::vector<std::string> objects;
+  std::deque<llvm::FileRemover> removers; // Remove the objects on all paths
+  for (std::size_t i = 0, count = std::max<std::size_t>(parts.size(), 1); i < count; ++i) {
+    llvm::SmallString<128> object;
+    if (auto ec = llvm::sys::fs::createTemporaryFile("pclc", "o", object))
+      throw std::runtime_error(fmt::format("Can't create a temporary file: {}", ec.message()));
+    removers.emplace_back(object);
+    objects.push_back(object.str().str());
+  }
+
+  if (parts.empty()) {
+    write_object(m, *tm, objects.front());
+    return link_executable(objects, output);
+  }
+
+  // A TargetMachine isn't thread safe, so every part gets its own. The objects are linked in the
+  // order of the parts, which keeps the executable the same for any number of threads.
+  std::vector<std::exception_ptr> errors(parts.size());
+  llvm::ThreadPool pool;
+  for (unsigned i = 0; i < parts.size(); ++i) {
+    pool.async([&, i] {
+      try {
+        auto part_tm = create_host_target_machine(opt_level);
+        parts[i].withModuleDo([&](llvm::Module &part) {
+          write_object(part, *part_tm, objects[i]);
+        });
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  pool.wait();
+
+  for (auto &error : errors)
+    if (error) std::rethrow_exception(error);
+  link_executable(objects, output);
+}
+
+} // namespace paracl::llvm_codegen
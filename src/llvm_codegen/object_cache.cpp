@@ -0,0 +1,109 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "llvm_codegen/object_cache.hpp"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace paracl::llvm_codegen {
+
+namespace fs = std::filesystem;
+
+object_cache::object_cache(fs::path dir, std::uintmax_t size_limit)
+    : m_dir{std::move(dir)}, m_size_limit{size_limit} {
+  fs::create_directories(m_dir);
+}
+
+auto object_cache::key(const llvm::Module &m) const -> std::string {
+  std::string text;
+  llvm::raw_string_ostream os{text};
+  os << LLVM_VERSION_STRING << '\0' << m_target << '\0' << m.getTargetTriple() << '\0';
+  m.print(os, nullptr);
+  os.flush();
+  return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(text)), true);
+}
+
+auto object_cache::getObject(const llvm::Module *m) -> std::unique_ptr<llvm::MemoryBuffer> {
+  auto module_key = key(*m);
+  auto file = path(module_key);
+  auto buffer = llvm::MemoryBuffer::getFile(file.string(), false, false);
+  if (buffer) {
+    ++m_hits;
+    std::error_code ec;
+    fs::last_write_time(file, fs::file_time_type::clock::now(), ec); // Most recently used now
+    return std::move(*buffer);
+  }
+
+  // Codegen passes change the IR, so the key is computed before the module is compiled.
+  ++m_misses;
+  std::scoped_lock lock{m_mutex};
+  m_pending.insert_or_assign(m, std::move(module_key));
+  return nullptr;
+}
+
+void object_cache::notifyObjectCompiled(const llvm::Module *m, llvm::MemoryBufferRef obj) {
+  std::scoped_lock lock{m_mutex};
+  auto found = m_pending.find(m);
+  if (found == m_pending.end()) return;
+  auto file = path(found->second);
+  m_pending.erase(found);
+
+  // Another process may be reading the same file, so it's replaced only once complete.
+  auto tmp = file;
+  tmp += ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+  {
+    std::ofstream os{tmp, std::ios::binary};
+    os.write(obj.getBufferStart(), static_cast<std::streamsize>(obj.getBufferSize()));
+    if (!os) return;
+  }
+  std::error_code ec;
+  fs::rename(tmp, file, ec);
+  if (ec) fs::remove(tmp, ec);
+  evict();
+}
+
+void object_cache::evict() {
+  struct entry {
+    fs::path path;
+    std::uintmax_t size;
+    fs::file_time_type used;
+  };
+
+  std::vector<entry> entries;
+  std::uintmax_t total = 0;
+  std::error_code ec;
+  for (auto &&file : fs::directory_iterator{m_dir, ec}) {
+    if (file.path().extension() != ".o") continue;
+    auto size = file.file_size(ec);
+    if (ec) continue;
+    auto used = file.last_write_time(ec);
+    if (ec) continue;
+    entries.push_back({file.path(), size, used});
+    total += size;
+  }
+  if (total <= m_size_limit) return;
+
+  std::ranges::sort(entries, {}, &entry::used);
+  for (auto &&[file, size, used] : entries) {
+    if (total <= m_size_limit) break;
+    if (fs::remove(file, ec)) total -= size;
+  }
+}
+
+} // namespace paracl::llvm_codegen
@@ -0,0 +1,74 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "llvm_codegen/codegen.hpp"
+
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <fmt/core.h>
+
+#include <stdexcept>
+
+namespace paracl::llvm_codegen {
+
+namespace {
+auto to_optimization_level(unsigned level) -> llvm::OptimizationLevel {
+  switch (level) {
+  case 0: return llvm::OptimizationLevel::O0;
+  case 1: return llvm::OptimizationLevel::O1;
+  case 2: return llvm::OptimizationLevel::O2;
+  case 3: return llvm::OptimizationLevel::O3;
+  default: throw std::invalid_argument(fmt::format("Unknown optimization level: {}", level));
+  }
+}
+} // namespace
+
+void optimize(llvm::Module &m, unsigned level, llvm::TargetMachine *tm) {
+  auto opt_level = to_optimization_level(level);
+
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+
+  llvm::PassBuilder pb{tm};
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+  auto mpm = level == 0 ? pb.buildO0DefaultPipeline(opt_level)
+                        : pb.buildPerModuleDefaultPipeline(opt_level);
+  mpm.run(m, mam);
+}
+
+void optimize_for(llvm::Module &m, llvm::TargetMachine &tm, unsigned level) {
+  // The pipeline needs the layout of the target to cost the transformations.
+  m.setDataLayout(tm.createDataLayout());
+  m.setTargetTriple(tm.getTargetTriple().str());
+  if (llvm::verifyModule(m, &llvm::errs()))
+    throw std::runtime_error("Generated LLVM IR is invalid");
+  optimize(m, level, &tm);
+}
+
+auto to_codegen_opt_level(unsigned level) -> llvm::CodeGenOpt::Level {
+  switch (level) {
+  case 0: return llvm::CodeGenOpt::None;
+  case 1: return llvm::CodeGenOpt::Less;
+  case 2: return llvm::CodeGenOpt::Default;
+  default: return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+} // namespace paracl::llvm_codegen
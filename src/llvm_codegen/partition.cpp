@@ -0,0 +1,83 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "llvm_codegen/partition.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace paracl::llvm_codegen {
+
+namespace orc = llvm::orc;
+
+namespace {
+bool has_definitions(const llvm::Module &m) {
+  auto defined = [](const llvm::GlobalValue &gv) { return !gv.isDeclaration(); };
+  return llvm::any_of(m.functions(), defined) || llvm::any_of(m.globals(), defined);
+}
+} // namespace
+
+unsigned partition_count(const llvm::Module &m) {
+  auto defined = llvm::count_if(m.functions(), [](auto &f) { return !f.isDeclaration(); });
+  auto count = static_cast<unsigned>(defined) / functions_per_partition;
+  return std::clamp(count, 1u, max_partitions);
+}
+
+std::vector<orc::ThreadSafeModule> split_module(llvm::Module &m, unsigned count) {
+  // The parts share the context of `m` when split, so they are moved to their own contexts through
+  // bitcode. Writing is sequential, which keeps the order of the parts.
+  std::vector<llvm::SmallString<0>> bitcode;
+  llvm::SplitModule(
+      m, count,
+      [&bitcode](std::unique_ptr<llvm::Module> part) {
+        if (!has_definitions(*part)) return;
+        llvm::raw_svector_ostream os{bitcode.emplace_back()};
+        llvm::WriteBitcodeToFile(*part, os);
+      },
+      /* PreserveLocals */ false
+  );
+
+  std::vector<orc::ThreadSafeModule> parts(bitcode.size());
+  std::vector<std::exception_ptr> errors(bitcode.size());
+  llvm::ThreadPool pool;
+  for (unsigned i = 0; i < bitcode.size(); ++i) {
+    pool.async([&, i] {
+      try {
+        auto ctx = std::make_unique<llvm::LLVMContext>();
+        llvm::MemoryBufferRef buffer{bitcode[i].str(), m.getModuleIdentifier()};
+        auto part = llvm::parseBitcodeFile(buffer, *ctx);
+        if (!part) throw std::runtime_error(llvm::toString(part.takeError()));
+        parts[i] = orc::ThreadSafeModule{std::move(*part), std::move(ctx)};
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  pool.wait();
+
+  for (auto &error : errors)
+    if (error) std::rethrow_exception(error);
+  return parts;
+}
+
+} // namespace paracl::llvm_codegen
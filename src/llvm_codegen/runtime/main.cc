@@ -0,0 +1,19 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <cstdlib>
+
+// Main of the program, renamed by emit_object. It flushes the output before returning.
+extern "C" void __pcl_main();
+
+int main() {
+  __pcl_main();
+  return EXIT_SUCCESS;
+}
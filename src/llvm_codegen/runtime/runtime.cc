@@ -0,0 +1,126 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+// Doesn't depend on LLVM or the rest of the compiler, the executables built by `pclc --emit-exe`
+// link it as is.
+
+#include "llvm_codegen/runtime.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+struct {
+  char *data = nullptr;
+  int32_t *size = nullptr;
+} output;
+
+class input_buffer {
+  static constexpr std::size_t buffer_size = 1 << 16;
+  char m_data[buffer_size];
+  std::size_t m_pos = 0, m_size = 0;
+
+private:
+  // Reads the next chunk, the output is flushed first in case it's a prompt.
+  bool refill() {
+    __flush_output();
+    m_pos = 0;
+    m_size = std::fread(m_data, 1, buffer_size, stdin);
+    return m_size;
+  }
+
+  int peek() {
+    if (m_pos == m_size && !refill()) return EOF;
+    return static_cast<unsigned char>(m_data[m_pos]);
+  }
+
+public:
+  // Parses a decimal int, returns false on the end of input or a malformed number.
+  bool read(int32_t &val) {
+    auto c = peek();
+    while (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+      ++m_pos;
+      c = peek();
+    }
+
+    bool negative = false;
+    if (c == '-' || c == '+') {
+      negative = c == '-';
+      ++m_pos;
+      c = peek();
+    }
+    if (c < '0' || c > '9') return false;
+
+    int64_t result = 0;
+    while (c >= '0' && c <= '9') {
+      result = result * 10 + (c - '0');
+      if (result > int64_t{INT32_MAX} + 1) return false;
+      ++m_pos;
+      c = peek();
+    }
+    if (negative) result = -result;
+    if (result > INT32_MAX) return false;
+    val = static_cast<int32_t>(result);
+    return true;
+  }
+};
+
+input_buffer input;
+utils::memo_table<int32_t> memo_storage;
+
+} // namespace
+
+extern "C" {
+
+void __attach_output(char *data, int32_t *size) {
+  output = {data, size};
+}
+
+void __flush_output() {
+  if (!output.data || !*output.size) return;
+  std::fwrite(output.data, 1, *output.size, stdout);
+  std::fflush(stdout);
+  *output.size = 0;
+}
+
+int32_t __read() {
+  int32_t val;
+  if (input.read(val)) return val;
+  __flush_output(); // Keep the output printed before the error
+  std::fputs("Error: Invalid read\n", stderr);
+  std::exit(EXIT_FAILURE);
+}
+
+void __bounds_error(int32_t index, int32_t size) {
+  __flush_output();
+  std::fprintf(stderr, "Error: Array index %d is out of bounds [0, %d)\n", index, size);
+  std::exit(EXIT_FAILURE);
+}
+
+int32_t __memo_lookup(int32_t id, const int32_t *args, int32_t n_args, int32_t *result) {
+  auto found = memo_storage.lookup(id, {args, static_cast<std::size_t>(n_args)});
+  if (!found) return 0;
+  *result = *found;
+  return 1;
+}
+
+void __memo_store(int32_t id, const int32_t *args, int32_t n_args, int32_t value) {
+  memo_storage.store(id, {args, args + n_args}, value);
+}
+}
+
+namespace paracl::llvm_codegen::runtime {
+
+const utils::memo_table<int32_t> &memo() {
+  return memo_storage;
+}
+
+} // namespace paracl::llvm_codegen::runtime
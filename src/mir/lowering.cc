@@ -0,0 +1,543 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "mir/lowering.hpp"
+#include "mir/passes.hpp"
+
+#include "frontend/ast/ast_nodes.hpp"
+#include "frontend/symtab.hpp"
+
+#include "ezvis/ezvis.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace paracl::mir {
+
+namespace {
+
+namespace ast = frontend::ast;
+namespace types = frontend::types;
+
+bool is_void(const types::generic_type &type) {
+  return !type || type == types::type_builtin::type_void;
+}
+
+bool is_array(const types::generic_type &type) {
+  return type && type.base().get_class() == types::type_class::E_ARRAY;
+}
+
+class function_lowering final
+    : public ezvis::visitor_base<const ast::i_ast_node, function_lowering, instruction *> {
+  // Variables are keyed by their definitions. Results of value blocks are variables too, keyed by
+  // the block itself.
+  using variable = const void *;
+
+  struct return_target {
+    basic_block *exit = nullptr; // nullptr when `return` leaves the function
+    variable result = nullptr;
+  };
+
+  const frontend::symtab &m_global_stab;
+  std::unordered_set<const ast::variable_expression *> &m_globals;
+
+  function &m_func;
+  const ast::function_definition *m_def;
+  basic_block *m_block = nullptr; // nullptr after a terminator, the code there is unreachable
+  std::vector<const frontend::symtab *> m_scopes;
+  std::vector<return_target> m_returns;
+
+  std::unordered_map<variable, std::unordered_map<const basic_block *, instruction *>> m_defs;
+  std::unordered_set<const basic_block *> m_sealed;
+  std::unordered_map<const basic_block *, std::vector<std::pair<variable, instruction *>>>
+      m_incomplete;
+  std::unordered_set<const instruction *> m_removed_phis; // Erased when the function is done
+  instruction *m_undef = nullptr;
+
+private:
+  basic_block &current_block() {
+    if (!m_block) { // Unreachable code, it's dropped by remove_unreachable_blocks
+      m_block = &m_func.create_block();
+      m_sealed.insert(m_block);
+    }
+    return *m_block;
+  }
+
+  instruction &emit(opcode op) { return current_block().append(op); }
+
+  instruction &emit_constant(int value) {
+    auto &inst = emit(opcode::E_CONST);
+    inst.imm = value;
+    return inst;
+  }
+
+  // Keeps the blocks in the order of the source code when a block is created ahead of time.
+  void move_to_end(const basic_block &block) {
+    auto &blocks = m_func.blocks;
+    auto found = std::find_if(blocks.begin(), blocks.end(), [&block](auto &&ptr) {
+      return ptr.get() == &block;
+    });
+    assert(found != blocks.end());
+    std::rotate(found, std::next(found), blocks.end());
+  }
+
+  void link(basic_block &to) { to.predecessors.push_back(m_block); }
+
+  void jump(basic_block &to) {
+    if (!m_block) return;
+    emit(opcode::E_JUMP).targets = {&to};
+    link(to);
+    m_block = nullptr;
+  }
+
+  void branch(instruction &cond, basic_block &if_true, basic_block &if_false) {
+    auto &inst = emit(opcode::E_BRANCH);
+    inst.operands = {&cond};
+    inst.targets = {&if_true, &if_false};
+    link(if_true);
+    link(if_false);
+    m_block = nullptr;
+  }
+
+  // Variables read before any assignment are zero, just like in the other backends.
+  instruction *undef() {
+    if (m_undef) return m_undef;
+    m_undef = &m_func.entry().prepend(opcode::E_CONST);
+    return m_undef;
+  }
+
+  // SSA construction
+
+  void write_variable(variable var, const basic_block *block, instruction *value) {
+    m_defs[var][block] = value;
+  }
+
+  instruction *read_variable(variable var, basic_block *block) {
+    auto &defs = m_defs[var];
+    if (auto found = defs.find(block); found != defs.end()) return found->second;
+    return read_variable_recursive(var, block);
+  }
+
+  instruction *read_variable_recursive(variable var, basic_block *block) {
+    instruction *value = nullptr;
+
+    if (!m_sealed.contains(block)) { // Not all predecessors are known yet
+      value = &block->prepend(opcode::E_PHI);
+      m_incomplete[block].emplace_back(var, value);
+    }
+
+    else if (block->predecessors.empty()) value = undef();
+    else if (block->predecessors.size() == 1) value = read_variable(var, block->predecessors.front());
+
+    else {
+      auto &phi = block->prepend(opcode::E_PHI);
+      write_variable(var, block, &phi); // Breaks cycles
+      value = add_phi_operands(var, phi);
+    }
+
+    write_variable(var, block, value);
+    return value;
+  }
+
+  instruction *add_phi_operands(variable var, instruction &phi) {
+    for (auto *pred : phi.parent->predecessors) {
+      phi.operands.push_back(read_variable(var, pred));
+    }
+    return try_remove_trivial_phi(phi);
+  }
+
+  instruction *try_remove_trivial_phi(instruction &phi) {
+    if (m_removed_phis.contains(&phi)) return &phi;
+
+    instruction *same = nullptr;
+    for (auto *op : phi.operands) {
+      if (op == same || op == &phi) continue;
+      if (same) return &phi; // Merges at least two values
+      same = op;
+    }
+
+    if (!same) same = undef(); // Unreachable or only references itself
+
+    std::vector<instruction *> users;
+    for (auto &bb : m_func.blocks) {
+      for (auto &inst : bb->instructions) {
+        const bool uses = std::find(inst->operands.begin(), inst->operands.end(), &phi) !=
+                          inst->operands.end();
+        if (uses && inst.get() != &phi && inst->op == opcode::E_PHI) users.push_back(inst.get());
+      }
+    }
+
+    m_func.replace_uses(&phi, same);
+    for (auto &[var, defs] : m_defs) {
+      for (auto &[bb, value] : defs) {
+        if (value == &phi) value = same;
+      }
+    }
+
+    m_removed_phis.insert(&phi);
+    for (auto *user : users) {
+      try_remove_trivial_phi(*user);
+    }
+
+    return same;
+  }
+
+  void seal(basic_block &block) {
+    for (auto &[var, phi] : m_incomplete[&block]) {
+      add_phi_operands(var, *phi);
+    }
+    m_incomplete.erase(&block);
+    m_sealed.insert(&block);
+  }
+
+  // Variables of the source program
+
+  const ast::variable_expression *resolve(std::string_view name) {
+    for (auto start = m_scopes.rbegin(), finish = m_scopes.rend(); start != finish; ++start) {
+      if (auto attr = (*start)->get_attributes(name); attr) return attr->m_definition;
+    }
+
+    // Functions can only see the variables of main's global scope.
+    auto attr = m_global_stab.get_attributes(name);
+    if (!attr) throw std::logic_error{"Can't resolve a variable while lowering to MIR"};
+    m_globals.insert(attr->m_definition);
+    return attr->m_definition;
+  }
+
+  instruction *load(const ast::variable_expression *var) {
+    if (!m_globals.contains(var)) return read_variable(var, &current_block());
+    auto &inst = emit(opcode::E_LOAD_GLOBAL);
+    inst.symbol = var->name();
+    return &inst;
+  }
+
+  void store(const ast::variable_expression *var, instruction *value) {
+    if (!m_globals.contains(var)) return write_variable(var, &current_block(), value);
+    auto &inst = emit(opcode::E_STORE_GLOBAL);
+    inst.symbol = var->name();
+    inst.operands = {value};
+  }
+
+  void begin_scope(const frontend::symtab &stab) {
+    m_scopes.push_back(&stab);
+
+    std::vector<frontend::symtab::attributes> arrays;
+    for (const auto &[name, attr] : stab) {
+      if (attr.m_definition && is_array(attr.m_definition->type)) arrays.push_back(attr);
+    }
+
+    std::sort(arrays.begin(), arrays.end(), [](auto &&lhs, auto &&rhs) {
+      return lhs.m_loc < rhs.m_loc;
+    });
+
+    for (const auto &attr : arrays) {
+      auto &type = static_cast<const types::type_array &>(attr.m_definition->type.base());
+      auto &arr = emit(opcode::E_ARRAY);
+      arr.imm = type.size;
+      store(attr.m_definition, &arr);
+    }
+  }
+
+  void end_scope() { m_scopes.pop_back(); }
+
+  template <typename t_block> void lower_statements(const t_block &ref) {
+    for (const auto *st : ref) {
+      assert(st && "Broken statement pointer in a block");
+      if (!m_block) break; // Everything after a return is unreachable
+      apply(*st);
+    }
+  }
+
+public:
+  function_lowering(
+      function &func, const ast::function_definition *def, const frontend::symtab &global_stab,
+      std::unordered_set<const ast::variable_expression *> &globals
+  )
+      : m_global_stab{global_stab}, m_globals{globals}, m_func{func}, m_def{def} {}
+
+  EZVIS_VISIT_CT(ast::tuple_all_nodes)
+
+  instruction *lower(const ast::constant_expression &ref) { return &emit_constant(ref.value()); }
+  instruction *lower(const ast::read_expression &) { return &emit(opcode::E_READ); }
+  instruction *lower(const ast::variable_expression &ref) { return load(resolve(ref.name())); }
+
+  instruction *lower(const ast::binary_expression &ref) {
+    auto *left = apply(ref.left());
+    auto *right = apply(ref.right());
+    auto &inst = emit(opcode::E_BINARY);
+    inst.bin_op = ref.op_type();
+    inst.operands = {left, right};
+    return &inst;
+  }
+
+  instruction *lower(const ast::unary_expression &ref) {
+    auto *value = apply(ref.expr());
+    if (ref.op_type() == ast::unary_operation::E_UN_OP_POS) return value;
+    auto &inst = emit(opcode::E_UNARY);
+    inst.un_op = ref.op_type();
+    inst.operands = {value};
+    return &inst;
+  }
+
+  instruction *lower(const ast::subscript &ref) {
+    auto *arr = load(resolve(ref.name()));
+    auto *index = apply(*ref.get_subscript());
+    auto &inst = emit(opcode::E_LOAD_ELEMENT);
+    inst.operands = {arr, index};
+    return &inst;
+  }
+
+  instruction *lower(const ast::assignment_statement &ref) {
+    auto *value = apply(ref.right());
+
+    for (auto start = ref.rbegin(), finish = ref.rend(); start != finish; ++start) {
+      if (std::holds_alternative<ast::subscript>(*start)) {
+        auto &sub = std::get<ast::subscript>(*start);
+        auto *arr = load(resolve(sub.name()));
+        auto *index = apply(*sub.get_subscript());
+        emit(opcode::E_STORE_ELEMENT).operands = {arr, index, value};
+        continue;
+      }
+
+      auto &var = std::get<ast::variable_expression>(*start);
+      if (is_array(var.type)) continue; // Arrays are zero-filled when their scope is entered
+      store(resolve(var.name()), value);
+    }
+
+    return value;
+  }
+
+  instruction *lower(const ast::function_call &ref) {
+    std::vector<instruction *> args;
+    for (const auto *arg : ref) {
+      assert(arg);
+      args.push_back(apply(*arg));
+    }
+
+    if (!ref.m_def) args.insert(args.begin(), load(resolve(ref.name())));
+    auto &inst = emit(ref.m_def ? opcode::E_CALL : opcode::E_CALL_INDIRECT);
+    if (ref.m_def) inst.symbol = ref.m_def->name.value();
+    inst.operands = std::move(args);
+    inst.has_value = !is_void(ref.type);
+    return inst.has_value ? &inst : nullptr;
+  }
+
+  instruction *lower(const ast::function_definition_to_ptr_conv &ref) {
+    auto &inst = emit(opcode::E_FUNCTION);
+    inst.symbol = ref.definition().name.value();
+    return &inst;
+  }
+
+  instruction *lower(const ast::print_statement &ref) {
+    auto *value = apply(ref.expr());
+    emit(opcode::E_PRINT).operands = {value};
+    return nullptr;
+  }
+
+  instruction *lower(const ast::statement_block &ref) {
+    begin_scope(ref.stab);
+    lower_statements(ref);
+    end_scope();
+    return nullptr;
+  }
+
+  instruction *lower(const ast::value_block &ref) {
+    const bool is_body = m_def && &ref == &m_def->body();
+    const bool has_result = !is_body && !is_void(ref.type);
+
+    // Function bodies and void blocks return to the enclosing target, like in the bytecode.
+    if (!has_result) {
+      begin_scope(ref.stab);
+      lower_statements(ref);
+      end_scope();
+      return nullptr;
+    }
+
+    auto &exit = m_func.create_block();
+    m_returns.push_back({&exit, &ref});
+
+    begin_scope(ref.stab);
+    lower_statements(ref);
+    end_scope();
+
+    if (m_block) { // The semantic analyzer makes every value block end with a return
+      write_variable(&ref, m_block, undef());
+      jump(exit);
+    }
+
+    m_returns.pop_back();
+    move_to_end(exit);
+    seal(exit);
+    if (exit.predecessors.empty()) return undef();
+
+    m_block = &exit;
+    return read_variable(&ref, &exit);
+  }
+
+  instruction *lower(const ast::return_statement &ref) {
+    auto *value = (ref.empty() ? nullptr : apply(ref.expr()));
+    const auto &target = m_returns.back();
+
+    if (!target.exit) {
+      auto &inst = emit(opcode::E_RETURN);
+      if (m_func.returns_value) inst.operands = {value ? value : undef()};
+      m_block = nullptr;
+      return nullptr;
+    }
+
+    write_variable(target.result, m_block, value ? value : undef());
+    jump(*target.exit);
+    return nullptr;
+  }
+
+  instruction *lower(const ast::if_statement &ref) {
+    begin_scope(ref.control_block_symtab);
+    auto *cond = apply(*ref.cond());
+
+    auto &true_block = m_func.create_block();
+    auto *else_block = (ref.else_block() ? &m_func.create_block() : nullptr);
+    auto &join = m_func.create_block();
+    auto &false_block = (else_block ? *else_block : join);
+    branch(*cond, true_block, false_block);
+    m_sealed.insert(&true_block);
+
+    m_block = &true_block;
+    apply(*ref.true_block());
+    jump(join);
+
+    if (ref.else_block()) {
+      m_sealed.insert(&false_block);
+      m_block = &false_block;
+      apply(*ref.else_block());
+      jump(join);
+    }
+
+    seal(join);
+    m_block = (join.predecessors.empty() ? nullptr : &join);
+    end_scope();
+    return nullptr;
+  }
+
+  instruction *lower(const ast::while_statement &ref) {
+    begin_scope(ref.symbol_table);
+
+    auto &header = m_func.create_block();
+    jump(header);
+    m_block = &header;
+
+    auto *cond = apply(*ref.cond());
+    auto &body = m_func.create_block();
+    auto &exit = m_func.create_block();
+    branch(*cond, body, exit);
+    m_sealed.insert(&body);
+    m_sealed.insert(&exit);
+
+    m_block = &body;
+    apply(*ref.block());
+    jump(header);
+    seal(header);
+
+    m_block = &exit;
+    end_scope();
+    return nullptr;
+  }
+
+  // Definitions are lowered separately, see lower_function.
+  instruction *lower(const ast::function_definition &) { return nullptr; }
+
+  instruction *lower(const ast::i_ast_node &) {
+    throw std::logic_error{"Unexpected node while lowering to MIR"};
+  }
+
+  EZVIS_VISIT_INVOKER(lower);
+
+  void lower_main(const ast::i_ast_node &root) {
+    m_block = &m_func.create_block();
+    m_sealed.insert(m_block);
+    m_returns.push_back({});
+    apply(root);
+    finish();
+  }
+
+  void lower_function() {
+    assert(m_def);
+    m_block = &m_func.create_block();
+    m_sealed.insert(m_block);
+    m_scopes.push_back(&m_def->param_stab);
+
+    int index = 0;
+    for (const auto &param : *m_def) {
+      auto &inst = emit(opcode::E_PARAM);
+      inst.imm = index++;
+      write_variable(m_def->param_stab.get_attributes(param.name())->m_definition, m_block, &inst);
+    }
+
+    m_returns.push_back({});
+    apply(m_def->body());
+    finish();
+  }
+
+private:
+  void finish() {
+    if (m_block) {
+      auto &inst = emit(opcode::E_RETURN);
+      if (m_func.returns_value) inst.operands = {undef()};
+    }
+
+    for (auto &bb : m_func.blocks) {
+      std::erase_if(bb->instructions, [this](auto &&inst) {
+        return m_removed_phis.contains(inst.get());
+      });
+    }
+
+    remove_unreachable_blocks(m_func);
+  }
+};
+
+} // namespace
+
+module lower(const ast::ast_container &ast, const frontend::functions_analytics &functions) {
+  module mod;
+  auto *root = ast.get_root_ptr();
+  if (!root) return mod;
+
+  auto &root_block = static_cast<const ast::statement_block &>(*root);
+  auto &main = mod.create_function("main", 0, false);
+
+  // Functions go first, they decide which variables of main have to live in memory.
+  std::unordered_set<const ast::variable_expression *> globals;
+  for (auto &&[key, attr] : functions.usegraph) {
+    auto &&[name, def] = attr.value;
+    if (!functions.named_functions.lookup(name)) continue; // Eliminated as unreachable
+    assert(def);
+
+    auto &func = mod.create_function(name, def->size(), !is_void(def->type.m_return_type));
+    function_lowering{func, def, root_block.stab, globals}.lower_function();
+  }
+
+  function_lowering{main, nullptr, root_block.stab, globals}.lower_main(*root);
+
+  for (const auto *var : globals) {
+    mod.globals.emplace_back(var->name());
+  }
+  std::sort(mod.globals.begin(), mod.globals.end());
+
+  return mod;
+}
+
+} // namespace paracl::mir
@@ -0,0 +1,157 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "mir/mir.hpp"
+
+#include <fmt/core.h>
+
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace paracl::mir {
+
+namespace {
+
+std::string_view binary_mnemonic(frontend::ast::binary_operation op) {
+  using bin_op = frontend::ast::binary_operation;
+  switch (op) {
+  case bin_op::E_BIN_OP_ADD: return "add";
+  case bin_op::E_BIN_OP_SUB: return "sub";
+  case bin_op::E_BIN_OP_MUL: return "mul";
+  case bin_op::E_BIN_OP_DIV: return "div";
+  case bin_op::E_BIN_OP_MOD: return "mod";
+  case bin_op::E_BIN_OP_EQ: return "eq";
+  case bin_op::E_BIN_OP_NE: return "ne";
+  case bin_op::E_BIN_OP_GT: return "gt";
+  case bin_op::E_BIN_OP_LS: return "ls";
+  case bin_op::E_BIN_OP_GE: return "ge";
+  case bin_op::E_BIN_OP_LE: return "le";
+  case bin_op::E_BIN_OP_AND: return "and";
+  case bin_op::E_BIN_OP_OR: return "or";
+  }
+  assert(0 && "Broken binary_operation enum");
+  return "";
+}
+
+class function_dumper final {
+  const function &m_func;
+  std::ostream &m_os;
+  std::unordered_map<const basic_block *, unsigned> m_blocks;
+  std::unordered_map<const instruction *, unsigned> m_values;
+
+private:
+  std::string block(const basic_block *ref) const { return fmt::format("bb{}", m_blocks.at(ref)); }
+  std::string value(const instruction *ref) const { return fmt::format("%{}", m_values.at(ref)); }
+
+  std::string operands(const instruction &ref, std::size_t from = 0) const {
+    std::string result;
+    for (auto i = from; i < ref.operands.size(); ++i) {
+      if (i != from) result += ", ";
+      result += value(ref.operands[i]);
+    }
+    return result;
+  }
+
+  std::string format(const instruction &ref) const {
+    switch (ref.op) {
+    case opcode::E_CONST: return fmt::format("const {}", ref.imm);
+    case opcode::E_PARAM: return fmt::format("param {}", ref.imm);
+    case opcode::E_PHI: {
+      std::string result = "phi ";
+      const auto &preds = ref.parent->predecessors;
+      for (std::size_t i = 0; i < ref.operands.size(); ++i) {
+        if (i) result += ", ";
+        result += fmt::format("[{}, {}]", value(ref.operands[i]), block(preds.at(i)));
+      }
+      return result;
+    }
+    case opcode::E_BINARY: return fmt::format("{} {}", binary_mnemonic(ref.bin_op), operands(ref));
+    case opcode::E_UNARY:
+      return fmt::format(
+          "{} {}", ref.un_op == frontend::ast::unary_operation::E_UN_OP_NOT ? "not" : "neg",
+          operands(ref)
+      );
+    case opcode::E_READ: return "read";
+    case opcode::E_PRINT: return fmt::format("print {}", operands(ref));
+    case opcode::E_LOAD_GLOBAL: return fmt::format("load @{}", ref.symbol);
+    case opcode::E_STORE_GLOBAL: return fmt::format("store @{}, {}", ref.symbol, operands(ref));
+    case opcode::E_ARRAY: return fmt::format("array {}", ref.imm);
+    case opcode::E_LOAD_ELEMENT: return fmt::format("load_element {}", operands(ref));
+    case opcode::E_STORE_ELEMENT: return fmt::format("store_element {}", operands(ref));
+    case opcode::E_FUNCTION: return fmt::format("function @{}", ref.symbol);
+    case opcode::E_CALL: return fmt::format("call @{}({})", ref.symbol, operands(ref));
+    case opcode::E_CALL_INDIRECT:
+      return fmt::format("call {}({})", value(ref.operands.at(0)), operands(ref, 1));
+    case opcode::E_JUMP: return fmt::format("jump {}", block(ref.targets.at(0)));
+    case opcode::E_BRANCH:
+      return fmt::format(
+          "branch {}, {}, {}", operands(ref), block(ref.targets.at(0)), block(ref.targets.at(1))
+      );
+    case opcode::E_RETURN: return ref.operands.empty() ? "ret" : fmt::format("ret {}", operands(ref));
+    }
+    assert(0 && "Broken opcode enum");
+    return "";
+  }
+
+public:
+  function_dumper(const function &func, std::ostream &os) : m_func{func}, m_os{os} {
+    unsigned values = 0;
+    for (const auto &bb : m_func.blocks) {
+      m_blocks.emplace(bb.get(), m_blocks.size());
+      for (const auto &inst : bb->instructions) {
+        if (inst->has_value) m_values.emplace(inst.get(), values++);
+      }
+    }
+  }
+
+  void dump() {
+    m_os << fmt::format(
+        "function @{}({}){} {{\n", m_func.name, m_func.n_params, m_func.returns_value ? " -> int" : ""
+    );
+
+    for (const auto &bb : m_func.blocks) {
+      m_os << block(bb.get()) << ":";
+      if (!bb->predecessors.empty()) {
+        m_os << " ; preds:";
+        for (const auto *pred : bb->predecessors) {
+          m_os << " " << block(pred);
+        }
+      }
+      m_os << "\n";
+
+      for (const auto &inst : bb->instructions) {
+        m_os << "  ";
+        if (inst->has_value) m_os << value(inst.get()) << " = ";
+        m_os << format(*inst) << "\n";
+      }
+    }
+
+    m_os << "}\n";
+  }
+};
+
+} // namespace
+
+void dump(const module &mod, std::ostream &os) {
+  for (const auto &name : mod.globals) {
+    os << fmt::format("global @{}\n", name);
+  }
+
+  bool first = mod.globals.empty();
+  for (const auto &func : mod.functions) {
+    if (!std::exchange(first, false)) os << "\n";
+    function_dumper{*func, os}.dump();
+  }
+}
+
+} // namespace paracl::mir
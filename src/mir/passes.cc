@@ -0,0 +1,221 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <tsimmerman.ss@phystech.edu>, <alex.rom23@mail.ru> wrote this file.  As long as you
+ * retain this notice you can do whatever you want with this stuff. If we meet
+ * some day, and you think this stuff is worth it, you can buy me a beer in
+ * return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "mir/passes.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace paracl::mir {
+
+namespace {
+
+std::optional<int> evaluate(const instruction &inst) {
+  auto is_constant = [](const instruction *op) { return op->op == opcode::E_CONST; };
+  if (!std::all_of(inst.operands.begin(), inst.operands.end(), is_constant)) return std::nullopt;
+
+  if (inst.op == opcode::E_BINARY) {
+    return frontend::ast::evaluate_binary_operation(
+        inst.bin_op, inst.operands[0]->imm, inst.operands[1]->imm
+    );
+  }
+
+  if (inst.op == opcode::E_UNARY) {
+    return frontend::ast::evaluate_unary_operation(inst.un_op, inst.operands[0]->imm);
+  }
+
+  return std::nullopt;
+}
+
+} // namespace
+
+unsigned remove_unreachable_blocks(function &func) {
+  std::unordered_set<const basic_block *> reachable;
+  std::vector<basic_block *> worklist = {&func.entry()};
+
+  while (!worklist.empty()) {
+    auto *block = worklist.back();
+    worklist.pop_back();
+    if (!reachable.insert(block).second) continue;
+    for (auto *succ : block->successors()) {
+      worklist.push_back(succ);
+    }
+  }
+
+  for (auto &block : func.blocks) {
+    if (!reachable.contains(block.get())) continue;
+    for (auto i = block->predecessors.size(); i-- > 0;) {
+      if (!reachable.contains(block->predecessors[i])) block->remove_predecessor(i);
+    }
+  }
+
+  return std::erase_if(func.blocks, [&reachable](auto &&block) {
+    return !reachable.contains(block.get());
+  });
+}
+
+unsigned fold_constants(function &func) {
+  unsigned folded = 0;
+  for (auto &block : func.blocks) {
+    for (auto &inst : block->instructions) {
+      auto value = evaluate(*inst);
+      if (!value) continue;
+
+      inst->op = opcode::E_CONST;
+      inst->imm = *value;
+      inst->operands.clear();
+      ++folded;
+    }
+  }
+
+  return folded;
+}
+
+unsigned fold_branches(function &func) {
+  unsigned folded = 0;
+  for (auto &block : func.blocks) {
+    if (!block->terminated()) continue;
+    auto &term = *block->instructions.back();
+    if (term.op != opcode::E_BRANCH || term.operands[0]->op != opcode::E_CONST) continue;
+
+    auto *taken = term.targets[term.operands[0]->imm ? 0 : 1];
+    auto *not_taken = term.targets[term.operands[0]->imm ? 1 : 0];
+
+    if (taken != not_taken) {
+      auto &preds = not_taken->predecessors;
+      auto found = std::find(preds.begin(), preds.end(), block.get());
+      assert(found != preds.end());
+      not_taken->remove_predecessor(std::distance(preds.begin(), found));
+    }
+
+    term.op = opcode::E_JUMP;
+    term.operands.clear();
+    term.targets = {taken};
+    ++folded;
+  }
+
+  if (folded) remove_unreachable_blocks(func);
+  return folded;
+}
+
+unsigned merge_blocks(function &func) {
+  unsigned merged = 0;
+
+  auto try_merge = [&func](basic_block &block) {
+    if (!block.terminated() || block.instructions.back()->op != opcode::E_JUMP) return false;
+    auto *next = block.instructions.back()->targets.front();
+    if (next == &block || next == &func.entry() || next->predecessors.size() != 1) return false;
+
+    auto &insts = next->instructions;
+    while (!insts.empty() && insts.front()->op == opcode::E_PHI) {
+      func.replace_uses(insts.front().get(), insts.front()->operands.front());
+      insts.pop_front();
+    }
+
+    block.instructions.pop_back();
+    for (auto &inst : insts) {
+      inst->parent = &block;
+    }
+    block.instructions.splice(block.instructions.end(), insts);
+
+    for (auto *succ : block.successors()) {
+      std::replace(succ->predecessors.begin(), succ->predecessors.end(), next, &block);
+    }
+
+    std::erase_if(func.blocks, [next](auto &&ptr) { return ptr.get() == next; });
+    return true;
+  };
+
+  // Merging erases a block, so start over after every change.
+  for (std::size_t i = 0; i < func.blocks.size();) {
+    if (!try_merge(*func.blocks[i])) {
+      ++i;
+      continue;
+    }
+    ++merged;
+    i = 0;
+  }
+
+  return merged;
+}
+
+unsigned remove_trivial_phis(function &func) {
+  unsigned removed = 0;
+  for (auto &block : func.blocks) {
+    auto &insts = block->instructions;
+    for (auto start = insts.begin(); start != insts.end() && (*start)->op == opcode::E_PHI;) {
+      auto &phi = **start;
+      instruction *same = nullptr;
+      bool trivial = true;
+
+      for (auto *op : phi.operands) {
+        if (op == same || op == &phi) continue;
+        if (same) trivial = false;
+        same = op;
+      }
+
+      // A phi without other operands is only possible in unreachable code.
+      if (!trivial || !same) {
+        ++start;
+        continue;
+      }
+
+      func.replace_uses(&phi, same);
+      start = insts.erase(start);
+      ++removed;
+    }
+  }
+
+  return removed;
+}
+
+unsigned remove_dead_values(function &func) {
+  unsigned removed = 0;
+
+  for (bool changed = true; changed;) {
+    changed = false;
+
+    std::unordered_map<const instruction *, unsigned> uses;
+    for (auto &block : func.blocks) {
+      for (auto &inst : block->instructions) {
+        for (const auto *op : inst->operands) {
+          if (op != inst.get()) ++uses[op];
+        }
+      }
+    }
+
+    for (auto &block : func.blocks) {
+      const auto erased = std::erase_if(block->instructions, [&uses](auto &&inst) {
+        return inst->is_removable() && !uses.contains(inst.get());
+      });
+
+      removed += erased;
+      changed = changed || erased;
+    }
+  }
+
+  return removed;
+}
+
+void optimize(module &mod) {
+  for (auto &func : mod.functions) {
+    while (fold_constants(*func) + fold_branches(*func) + merge_blocks(*func) +
+           remove_trivial_phis(*func) + remove_dead_values(*func)) {
+    }
+  }
+}
+
+} // namespace paracl::mir
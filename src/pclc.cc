@@ -15,20 +15,28 @@
 #include "common.hpp"
 
 #include "llvm_codegen/codegen.hpp"
+#include "llvm_codegen/jit.hpp"
+#include "llvm_codegen/native.hpp"
+#include "llvm_codegen/runtime.hpp"
+
+#include "mir/lowering.hpp"
+#include "mir/mir.hpp"
+#include "mir/passes.hpp"
+
+#include "utils/profile.hpp"
 
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/ExecutionEngine/GenericValue.h>
-#include <llvm/ExecutionEngine/MCJIT.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/TargetSelect.h>
 
 #include <boost/program_options.hpp>
 
 #include <concepts>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
@@ -61,9 +69,52 @@ int main(int argc, char *argv[]) try {
   std::string output_file_option;
   std::string input_file_name;
   std::string output_type_str;
+  unsigned unroll_factor;
+  unsigned opt_level;
+  unsigned jit_threads;
+  unsigned partitions;
+  std::string cache_dir;
+  std::uintmax_t cache_size;
+  std::string profile_file_name;
 
   desc.add_options()("help", "Produce help message");
   desc.add_options()("emit-llvm", "Dump LLVM IR");
+  desc.add_options()("compile-only,c", "Compile to a native object file, see --output");
+  desc.add_options()("emit-exe", "Compile to a native executable, see --output");
+  desc.add_options()("emit-mir", "Dump the optimized mid-level IR and exit");
+  desc.add_options()("memoize", "Cache the results of pure functions with int arguments");
+  desc.add_options()("memo-stats", "Print hit/miss counters of memoized functions after the run");
+  desc.add_options()(
+      "unroll",
+      po::value(&unroll_factor)->default_value(paracl::frontend::loop_unroller::default_factor),
+      "Unroll factor of counting loops, 1 disables unrolling"
+  );
+  desc.add_options()(
+      "opt-level,O", po::value(&opt_level)->default_value(2),
+      "Optimization level of the LLVM pipeline, 0 to 3"
+  );
+  desc.add_options()(
+      "jit-threads", po::value(&jit_threads)->default_value(0),
+      "Threads compiling functions for -t llvm, 0 uses one per core"
+  );
+  desc.add_options()(
+      "partitions", po::value(&partitions)->default_value(0),
+      "Modules compiled concurrently by -t llvm and --emit-exe, 0 decides by the program size"
+  );
+  desc.add_options()("cache-dir", po::value(&cache_dir), "Keep objects compiled by -t llvm here");
+  desc.add_options()(
+      "cache-size",
+      po::value(&cache_size)
+          ->default_value(paracl::llvm_codegen::object_cache::default_size_limit >> 20),
+      "Size limit of the object cache in MiB"
+  );
+  desc.add_options()("cache-stats", "Print hit/miss counters of the object cache after the run");
+  desc.add_options()("perf", "Name the functions compiled by -t llvm in /tmp/perf-<pid>.map");
+  desc.add_options()("debug-info,g", "Emit DWARF line tables for -t llvm, register them with GDB");
+  desc.add_options()(
+      "use-profile", po::value(&profile_file_name),
+      "Optimize -t llvm for the counts written by pclvm --write-profile"
+  );
   desc.add_options()("ast-dump,a", po::value(&ast_dump_option)->default_value(false), "Dump AST");
   desc.add_options()("input-file", po::value(&input_file_name), "Input file name");
   desc.add_options()(
@@ -92,6 +143,7 @@ int main(int argc, char *argv[]) try {
   }
 
   paracl::frontend::frontend_driver drv{input_file_name};
+  drv.set_unroll_factor(unroll_factor);
   drv.parse();
 
   const auto &parse_tree = drv.ast();
@@ -108,46 +160,75 @@ int main(int argc, char *argv[]) try {
     return k_exit_failure;
   }
 
+  std::optional<utils::execution_profile> profile;
+  if (!profile_file_name.empty()) {
+    std::ifstream profile_file{profile_file_name};
+    if (profile_file) profile = utils::execution_profile::read(profile_file);
+    if (!profile) throw std::runtime_error{fmt::format("Invalid profile `{}`", profile_file_name)};
+  }
+
+  if (vm.count("emit-mir")) {
+    auto mod = paracl::mir::lower(parse_tree, drv.functions());
+    paracl::mir::optimize(mod);
+    paracl::mir::dump(mod, std::cout);
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("compile-only") || vm.count("emit-exe")) {
+    if (output_file_option.empty()) {
+      fmt::println(stderr, "Output file must be specified");
+      return EXIT_FAILURE;
+    }
+
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::LLVMContext ctx;
+    paracl::llvm_codegen::codegen_options options;
+    options.memoize = vm.count("memoize");
+    options.profile = profile ? &*profile : nullptr;
+    options.debug_info = vm.count("debug-info");
+    auto m = paracl::llvm_codegen::emit_llvm(drv, ctx, options);
+    if (vm.count("compile-only")) {
+      paracl::llvm_codegen::emit_object(*m, opt_level, output_file_option);
+    } else {
+      paracl::llvm_codegen::emit_executable(*m, opt_level, output_file_option, partitions);
+    }
+    return EXIT_SUCCESS;
+  }
+
   if (out_type == output_type::LLVM) {
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargetMCs();
 
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
-    llvm::LLVMContext ctx;
-    auto m = paracl::llvm_codegen::emit_llvm(drv, ctx);
-    if (vm.count("emit-llvm")) m->dump();
-    auto &module_ref = *m;
-    std::string err;
-    auto *exec = llvm::EngineBuilder(std::move(m))
-                     .setEngineKind(llvm::EngineKind::JIT)
-                     .setErrorStr(&err)
-                     .create();
-    if (!err.empty()) throw std::runtime_error(err);
-    assert(exec);
-    std::unordered_map<std::string, void *> external_functions;
-    external_functions.try_emplace(
-        "__print", reinterpret_cast<void *>(paracl::llvm_codegen::intrinsics::print)
-    );
-    external_functions.try_emplace(
-        "__read", reinterpret_cast<void *>(paracl::llvm_codegen::intrinsics::read)
+    auto ctx = std::make_unique<llvm::LLVMContext>();
+    paracl::llvm_codegen::codegen_options options;
+    options.memoize = vm.count("memoize");
+    options.profile = profile ? &*profile : nullptr;
+    options.debug_info = vm.count("debug-info");
+    auto m = paracl::llvm_codegen::emit_llvm(drv, *ctx, options);
+    std::optional<paracl::llvm_codegen::object_cache> cache;
+    if (!cache_dir.empty()) cache.emplace(cache_dir, cache_size << 20);
+    paracl::llvm_codegen::run_jit(
+        std::move(m), std::move(ctx),
+        {opt_level, jit_threads, bool(vm.count("emit-llvm")), cache ? &*cache : nullptr,
+         bool(vm.count("perf")), bool(vm.count("debug-info")), partitions}
     );
 
-    exec->InstallLazyFunctionCreator([&](const std::string &name) -> void * {
-      auto it = external_functions.find(name);
-      if (it == external_functions.end()) return nullptr;
-      return it->second;
-    });
-
-    exec->finalizeObject();
-    exec->setVerifyModules(true);
-    exec->runFunction(module_ref.getFunction("main"), {});
+    if (cache && vm.count("cache-stats")) {
+      fmt::println(stderr, "Object cache: {} hits, {} misses", cache->hits(), cache->misses());
+    }
 
-    auto &Err = exec->getErrorMessage();
-    if (!Err.empty()) throw std::runtime_error(Err);
+    if (vm.count("memo-stats")) {
+      const auto &memo = paracl::llvm_codegen::runtime::memo();
+      print_memo_stats(memo.hits(), memo.misses());
+    }
     return EXIT_SUCCESS;
   }
   paracl::codegen::codegen_visitor generator;
+  generator.set_memoization(vm.count("memoize"));
+  generator.generate_all(parse_tree, drv.functions());
 
   auto ch = generator.to_chunk();
   if (!output_file_option.empty()) {
@@ -157,7 +238,7 @@ int main(int argc, char *argv[]) try {
     return EXIT_SUCCESS;
   }
 
-  execute_chunk(ch);
+  execute_chunk(ch, vm.count("memo-stats"));
 
 } catch (std::exception &e) {
   fmt::println(stderr, "Error: {}", e.what());
@@ -23,8 +23,13 @@ namespace po = boost::program_options;
 int main(int argc, char *argv[]) try {
   auto desc = po::options_description{"Allowed options"};
   std::string input_file_name;
+  std::string profile_file_name;
   desc.add_options()("help", "produce help message");
   desc.add_options()("input-file", po::value(&input_file_name)->default_value("a.out"), "Input file name");
+  desc.add_options()("memo-stats", "print hit/miss counters of memoized functions");
+  desc.add_options()(
+      "write-profile", po::value(&profile_file_name), "write branch and call counts for pclc --use-profile"
+  );
 
   po::positional_options_description pos_desc;
   pos_desc.add("input-file", -1);
@@ -52,7 +57,7 @@ int main(int argc, char *argv[]) try {
     fmt::println(stderr, "Could not read input binary");
     return k_exit_failure;
   }
-  execute_chunk(*ch);
+  execute_chunk(*ch, vm.count("memo-stats"), profile_file_name);
 
   return k_exit_success;
 } catch (std::exception &e) {